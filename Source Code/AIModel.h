@@ -1,6 +1,11 @@
 #ifndef AIMODEL_H
 #define AIMODEL_H
 
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
 #include <memory>
 #include <vector>
 #include <string>
@@ -8,8 +13,11 @@
 #include <exception>
 #include <mutex>
 #include <thread>
+#include <unordered_map>
 #include <algorithm>
 
+#include "MpscRing.h"
+
 // Forward declarations for integration with external AI/ML libraries (e.g., Dlib, mlpack, or TensorFlow’s C++ API)
 // #include <dlib/dnn.h>  // Uncomment and configure as needed
 
@@ -31,20 +39,174 @@ public:
     virtual void onTrainingEnd(const std::string& modelName) = 0;
 };
 
+// ===========================
+// Model Event Queue
+// ===========================
+
+/// One training event on its way to the observers.
+struct ModelEvent {
+    enum class Type : uint8_t {
+        TrainingStart,
+        TrainingProgress,
+        TrainingEnd
+    };
+
+    Type type = Type::TrainingProgress;
+    int epoch = 0;
+    double loss = 0.0;
+};
+
+/**
+ * @brief Bounded queue of ModelEvents delivered by a dispatcher thread.
+ *
+ * Producers copy the event into an MpscRing, without allocating, and wake the
+ * dispatcher only when it is idle. The dispatcher hands events to the delivery
+ * callback in queue order.
+ */
+class ModelEventQueue {
+public:
+    /**
+     * @param capacity Ring slots, rounded up to a power of two.
+     * @param deliver Called on the dispatcher thread for every event.
+     */
+    ModelEventQueue(size_t capacity, std::function<void(const ModelEvent&)> deliver)
+        : deliver_(std::move(deliver)), ring_(capacity) {
+        dispatcher_ = std::thread([this] { dispatchLoop(); });
+    }
+
+    /// Delivers everything still queued, then stops the dispatcher.
+    ~ModelEventQueue() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_one();
+        dispatcher_.join();
+    }
+
+    ModelEventQueue(const ModelEventQueue&) = delete;
+    ModelEventQueue& operator=(const ModelEventQueue&) = delete;
+
+    /// Queues an event; returns false if the ring is full.
+    bool tryPush(const ModelEvent& event) {
+        ModelEvent queued = event;
+        if (!ring_.tryPush(queued))
+            return false;
+        pushed_.fetch_add(1, std::memory_order_release);
+        // Pairs with the fence in the dispatcher's wait predicate.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (dispatcherIdle_.load(std::memory_order_relaxed)) {
+            { std::lock_guard<std::mutex> lock(mutex_); }
+            wake_.notify_one();
+        }
+        return true;
+    }
+
+    /// Queues an event, waiting for a free slot if the ring is full.
+    void push(const ModelEvent& event) {
+        while (!tryPush(event))
+            std::this_thread::yield();
+    }
+
+    /// Blocks until every event queued before the call has been delivered.
+    void flush() {
+        uint64_t target = pushed_.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(mutex_);
+        delivered_.wait(lock, [&] { return deliveredCount_ >= target; });
+    }
+
+private:
+    std::function<void(const ModelEvent&)> deliver_;
+    MpscRing<ModelEvent> ring_;
+    std::atomic<uint64_t> pushed_{0};
+    std::atomic<bool> dispatcherIdle_{false};
+
+    std::mutex mutex_;                              ///< Guards the fields below.
+    std::condition_variable wake_;
+    std::condition_variable delivered_;
+    uint64_t deliveredCount_ = 0;
+    bool stopping_ = false;
+    std::thread dispatcher_;
+
+    void dispatchLoop() {
+        ModelEvent event;
+        auto take = [&event](ModelEvent& queued) { event = queued; };
+        for (;;) {
+            uint64_t count = 0;
+            while (ring_.tryConsume(take)) {
+                ++count;
+                deliver_(event);
+            }
+            std::unique_lock<std::mutex> lock(mutex_);
+            if (count > 0) {
+                deliveredCount_ += count;
+                delivered_.notify_all();
+                continue;
+            }
+            if (stopping_)
+                break;
+            dispatcherIdle_.store(true, std::memory_order_relaxed);
+            wake_.wait(lock, [this] {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                return stopping_ || ring_.hasQueued();
+            });
+            dispatcherIdle_.store(false, std::memory_order_relaxed);
+        }
+    }
+};
+
 // ============================
 // Strategy Pattern Interface
 // ============================
 
+/// Mutable view of a model's parameters, stored contiguously.
+struct ParameterSpan {
+    float* data = nullptr;
+    size_t size = 0;
+};
+
+/// Read-only view of the gradients matching a ParameterSpan element for element.
+struct GradientSpan {
+    const float* data = nullptr;
+    size_t size = 0;
+};
+
 /**
  * @brief Interface for optimizer strategies.
  *
  * This interface enables different optimization algorithms (e.g., SGD, Adam)
  * to be integrated and swapped without modifying the AI model's core logic.
+ * An optimizer keeps whatever state it needs per parameter itself.
  */
 class IOptimizer {
 public:
     virtual ~IOptimizer() = default;
-    virtual void optimize() = 0;
+
+    /**
+     * @brief Applies one update to the parameters.
+     * @param parameters Updated in place.
+     * @param gradients Gradient of the loss; must have parameters.size elements.
+     * @param step 1 for the first update of a training run, counting up from
+     *        there. Step 1 resets any state left from an earlier run.
+     */
+    virtual void optimize(ParameterSpan parameters, GradientSpan gradients, uint64_t step) = 0;
+};
+
+// =============================
+// Sample Matrix View
+// =============================
+
+/**
+ * @brief Non-owning view of a row-major matrix of samples.
+ *
+ * Row i holds the `columns` features of sample i, starting at data + i * columns.
+ */
+struct SampleMatrix {
+    const double* data = nullptr;   ///< First feature of the first sample.
+    size_t rows = 0;                ///< Number of samples.
+    size_t columns = 0;             ///< Features per sample.
+
+    const double* row(size_t index) const { return data + index * columns; }
 };
 
 // =============================
@@ -56,16 +218,45 @@ public:
  *
  * This class provides the structure for model initialization, training,
  * and inference, along with observer support for tracking training events.
+ *
+ * The observer list is copy-on-write: attaching or detaching publishes a new
+ * immutable snapshot and bumps an epoch. A delivery records the epoch in a
+ * slot owned by its thread, then reads the current snapshot with one atomic
+ * load. With the default options (synchronous, progressInterval 1) concurrent
+ * notifications therefore share no written memory: no locks, shared counters
+ * or reference counts. A thread takes the observer mutex only to find its
+ * slot, when it notifies for a different model than it last did. The other
+ * options add shared state: a progressInterval above 1 counts every progress
+ * call on one shared atomic, and asynchronous delivery pushes into a shared
+ * ring and may take the dispatcher's mutex to wake it.
+ *
+ * Every distinct thread id that ever notifies keeps a slot for the life of the
+ * model, and every attach or detach scans all slots. A replaced snapshot is
+ * freed by the first attach or detach after every delivery that could still
+ * read it has finished, or by the destructor, so a detached observer may be
+ * released that much later.
  */
 class AIModel {
 public:
+    /// How training events reach the observers.
+    struct NotificationOptions {
+        bool asynchronous = false;      ///< Deliver from a dispatcher thread instead of the notifying one.
+        size_t queueCapacity = 1024;    ///< Asynchronous events in flight; progress beyond it is dropped.
+        unsigned progressInterval = 1;  ///< Deliver only every Nth progress event.
+    };
+
     /**
      * @brief Constructor to initialize the model with a name.
      * @param name The unique name of the model.
      */
     explicit AIModel(const std::string& name) : modelName(name) {}
 
-    virtual ~AIModel() = default;
+    virtual ~AIModel() {
+        eventQueue.reset();   // Deliver queued events while the observer list still exists.
+        delete observerList.load(std::memory_order_relaxed);
+        for (const auto& retired : retiredObservers)
+            delete retired.first;
+    }
 
     // Prevent copying due to the internal mutex and observer list.
     AIModel(const AIModel&) = delete;
@@ -94,73 +285,232 @@ public:
      */
     virtual double predict(const std::vector<double>& input) = 0;
 
+    /**
+     * @brief Perform inference on several samples at once.
+     *
+     * The default implementation calls predict() for each row; models that can
+     * share work between samples override it.
+     * @param inputs One sample per row.
+     * @param outputs Receives inputs.rows predictions, in row order.
+     */
+    virtual void predictBatch(const SampleMatrix& inputs, double* outputs) {
+        std::vector<double> sample(inputs.columns);
+        for (size_t i = 0; i < inputs.rows; ++i) {
+            sample.assign(inputs.row(i), inputs.row(i) + inputs.columns);
+            outputs[i] = predict(sample);
+        }
+    }
+
     /**
      * @brief Attach an observer to the model.
      * @param observer A shared pointer to an IModelObserver instance.
      */
     void attachObserver(const std::shared_ptr<IModelObserver>& observer) {
         std::lock_guard<std::mutex> lock(observerMutex);
-        observers.push_back(observer);
+        const ObserverList* current = observerList.load(std::memory_order_relaxed);
+        auto next = current ? std::make_unique<ObserverList>(*current) : std::make_unique<ObserverList>();
+        next->push_back(observer);
+        publishObservers(next.release());
     }
     
     /**
      * @brief Detach an observer from the model.
      * @param observer A shared pointer to the IModelObserver instance to remove.
+     *
+     * With asynchronous notifications, events queued before the call may
+     * still reach the observer; flushNotifications() waits for them.
      */
     void detachObserver(const std::shared_ptr<IModelObserver>& observer) {
         std::lock_guard<std::mutex> lock(observerMutex);
-        observers.erase(std::remove(observers.begin(), observers.end(), observer), observers.end());
+        const ObserverList* current = observerList.load(std::memory_order_relaxed);
+        if (!current)
+            return;
+        auto next = std::make_unique<ObserverList>(*current);
+        next->erase(std::remove(next->begin(), next->end(), observer), next->end());
+        publishObservers(next.release());
     }
 
+    /**
+     * @brief Choose synchronous or asynchronous delivery and progress throttling.
+     *
+     * Must not be called while the model is training. Switching away from
+     * asynchronous delivery first delivers the events still queued.
+     */
+    void setNotificationOptions(const NotificationOptions& options) {
+        eventQueue.reset();
+        notificationOptions = options;
+        notificationOptions.progressInterval = std::max(1u, options.progressInterval);
+        if (options.asynchronous)
+            eventQueue = std::make_unique<ModelEventQueue>(options.queueCapacity, [this](const ModelEvent& event) {
+                try {
+                    deliver(event);
+                } catch (const std::exception& e) {
+                    std::cerr << "[ERROR] Observer of " << modelName << " threw: " << e.what() << std::endl;
+                }
+            });
+    }
+
+    /// Blocks until every event notified so far has reached the observers.
+    void flushNotifications() {
+        if (eventQueue)
+            eventQueue->flush();
+    }
+
+    /// Progress events dropped because the asynchronous queue was full.
+    uint64_t droppedNotifications() const { return droppedProgress.load(std::memory_order_relaxed); }
+
 protected:
     /**
      * @brief Notify all observers that training is starting.
      */
     void notifyTrainingStart() {
-        std::vector<std::shared_ptr<IModelObserver>> localObservers;
-        {
-            std::lock_guard<std::mutex> lock(observerMutex);
-            localObservers = observers;
-        }
-        for (const auto& observer : localObservers) {
-            observer->onTrainingStart(modelName);
-        }
+        progressEvents.store(0, std::memory_order_relaxed);
+        dispatch(ModelEvent{ModelEvent::Type::TrainingStart, 0, 0.0});
     }
 
     /**
      * @brief Notify all observers about training progress.
+     *
+     * With a progressInterval of N only every Nth call since training
+     * started is delivered.
      * @param epoch The current epoch number.
      * @param loss The current loss value.
      */
     void notifyTrainingProgress(int epoch, double loss) {
-        std::vector<std::shared_ptr<IModelObserver>> localObservers;
-        {
-            std::lock_guard<std::mutex> lock(observerMutex);
-            localObservers = observers;
-        }
-        for (const auto& observer : localObservers) {
-            observer->onTrainingProgress(modelName, epoch, loss);
-        }
+        const unsigned interval = notificationOptions.progressInterval;
+        if (interval > 1 && (progressEvents.fetch_add(1, std::memory_order_relaxed) + 1) % interval != 0)
+            return;
+        ModelEvent event{ModelEvent::Type::TrainingProgress, epoch, loss};
+        if (!eventQueue)
+            deliver(event);
+        else if (!eventQueue->tryPush(event))
+            droppedProgress.fetch_add(1, std::memory_order_relaxed);
     }
 
     /**
      * @brief Notify all observers that training has ended.
      */
     void notifyTrainingEnd() {
-        std::vector<std::shared_ptr<IModelObserver>> localObservers;
-        {
-            std::lock_guard<std::mutex> lock(observerMutex);
-            localObservers = observers;
-        }
-        for (const auto& observer : localObservers) {
-            observer->onTrainingEnd(modelName);
-        }
+        dispatch(ModelEvent{ModelEvent::Type::TrainingEnd, 0, 0.0});
     }
 
 protected:
+    using ObserverList = std::vector<std::shared_ptr<IModelObserver>>;
+
     std::string modelName;                                         ///< Unique name of the model.
-    std::vector<std::shared_ptr<IModelObserver>> observers;        ///< List of observers for training events.
-    std::mutex observerMutex;                                      ///< Mutex to ensure thread-safe notifications.
+    /// Epoch a delivery on the owning thread started in; 0 while it is not reading.
+    struct alignas(64) ReaderSlot {
+        std::atomic<uint64_t> epoch{0};
+    };
+    using RetiredObservers = std::vector<std::pair<const ObserverList*, uint64_t>>;
+
+    std::atomic<const ObserverList*> observerList{nullptr};        ///< Current snapshot; null when empty.
+    std::atomic<uint64_t> observerEpoch{1};                        ///< Bumped by every attach and detach.
+    std::mutex observerMutex;                                      ///< Serializes attach, detach and slot registration.
+    std::deque<ReaderSlot> readerSlots;                            ///< One per thread id that notified; never shrinks.
+    std::unordered_map<std::thread::id, ReaderSlot*> readerSlotOf; ///< Slot of each thread id that notified.
+    RetiredObservers retiredObservers;                             ///< Replaced snapshots and the epoch that replaced them.
+    const uint64_t instanceId = nextInstanceId();                  ///< Keys the per-thread slot cache.
+    NotificationOptions notificationOptions;                       ///< Set by setNotificationOptions().
+    std::atomic<uint64_t> progressEvents{0};                       ///< Progress calls since training started.
+    std::atomic<uint64_t> droppedProgress{0};                      ///< Progress events lost to a full queue.
+    std::unique_ptr<ModelEventQueue> eventQueue;                   ///< Present in asynchronous mode.
+
+private:
+    // Start and end events are never dropped, so they wait for queue space.
+    void dispatch(const ModelEvent& event) {
+        if (eventQueue)
+            eventQueue->push(event);
+        else
+            deliver(event);
+    }
+
+    void deliver(const ModelEvent& event) {
+        // Only the outermost delivery on a thread owns the slot; one nested
+        // through an observer callback is covered by the older epoch.
+        struct ReadGuard {
+            ReaderSlot& slot;
+            bool outermost;
+            ReadGuard(ReaderSlot& s, const std::atomic<uint64_t>& epoch)
+                : slot(s), outermost(s.epoch.load(std::memory_order_relaxed) == 0) {
+                if (outermost)
+                    slot.epoch.store(epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+            }
+            ~ReadGuard() {
+                if (outermost)
+                    slot.epoch.store(0, std::memory_order_release);
+            }
+        } guard(readerSlot(), observerEpoch);
+        const ObserverList* list = observerList.load(std::memory_order_seq_cst);
+        if (!list)
+            return;
+        for (const auto& observer : *list) {
+            switch (event.type) {
+            case ModelEvent::Type::TrainingStart:
+                observer->onTrainingStart(modelName);
+                break;
+            case ModelEvent::Type::TrainingProgress:
+                observer->onTrainingProgress(modelName, event.epoch, event.loss);
+                break;
+            case ModelEvent::Type::TrainingEnd:
+                observer->onTrainingEnd(modelName);
+                break;
+            }
+        }
+    }
+
+    static uint64_t nextInstanceId() {
+        static std::atomic<uint64_t> next{1};
+        return next.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // The calling thread's slot. Threads cache the slot of the last model they
+    // notified for, so only the first delivery per thread takes the mutex.
+    ReaderSlot& readerSlot() {
+        thread_local uint64_t cachedModel = 0;
+        thread_local ReaderSlot* cachedSlot = nullptr;
+        if (cachedModel == instanceId)
+            return *cachedSlot;
+        std::lock_guard<std::mutex> lock(observerMutex);
+        ReaderSlot*& slot = readerSlotOf[std::this_thread::get_id()];
+        if (!slot) {
+            readerSlots.emplace_back();
+            slot = &readerSlots.back();
+        }
+        cachedModel = instanceId;
+        cachedSlot = slot;
+        return *slot;
+    }
+
+    // Called with observerMutex held. Snapshot store, epoch bump and slot
+    // reads are sequentially consistent with a reader's epoch load, slot store
+    // and snapshot load, so a reader still holding `previous` has a slot epoch
+    // below the new one.
+    void publishObservers(const ObserverList* next) {
+        const ObserverList* previous = observerList.load(std::memory_order_relaxed);
+        observerList.store(next, std::memory_order_seq_cst);
+        uint64_t epoch = observerEpoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+        if (previous)
+            retiredObservers.emplace_back(previous, epoch);
+        reclaimObservers();
+    }
+
+    // Called with observerMutex held; frees the snapshots replaced at or
+    // before the oldest epoch a delivery is still in. Scans every slot.
+    void reclaimObservers() {
+        uint64_t oldest = UINT64_MAX;
+        for (const ReaderSlot& slot : readerSlots) {
+            uint64_t epoch = slot.epoch.load(std::memory_order_seq_cst);
+            if (epoch != 0)
+                oldest = std::min(oldest, epoch);
+        }
+        auto reclaimable = [oldest](const RetiredObservers::value_type& retired) { return retired.second <= oldest; };
+        for (const auto& retired : retiredObservers)
+            if (reclaimable(retired))
+                delete retired.first;
+        retiredObservers.erase(std::remove_if(retiredObservers.begin(), retiredObservers.end(), reclaimable),
+                               retiredObservers.end());
+    }
 };
 
 // ==============================
@@ -0,0 +1,242 @@
+#ifndef ASYNCLOGWRITER_H
+#define ASYNCLOGWRITER_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+#include "MpscRing.h"
+
+// ===========================
+// Asynchronous Log Writer
+// ===========================
+
+/**
+ * @brief Appends records to a file from a dedicated writer thread.
+ *
+ * Producers only format their record and push it into a bounded lock-free
+ * multi-producer/single-consumer ring; the writer thread keeps the file open,
+ * drains the ring in batches with one write per batch, applies the fsync policy
+ * and rotates the file by size. When the ring is full a record is dropped and
+ * counted rather than blocking the caller. Records are raw bytes, so the same
+ * writer serves text and binary logs.
+ *
+ * append() never locks or signals the writer. The writer polls the ring
+ * instead, backing off to Options::maxPollInterval while it finds nothing, so
+ * a record reaches the file at most that long after it was queued; flush()
+ * and the destructor wake the writer at once.
+ */
+class AsyncLogWriter {
+public:
+    enum class FsyncPolicy {
+        Never,        ///< Leave durability to the OS.
+        EveryBatch,   ///< fsync after every batch written.
+        Interval      ///< fsync at most once per Options::fsyncInterval.
+    };
+
+    struct Options {
+        size_t capacity = 8192;                      ///< Ring slots, rounded up to a power of two.
+        size_t maxBatchRecords = 1024;               ///< Records per write.
+        uint64_t maxFileBytes = 10 * 1024 * 1024;    ///< Rotate beyond this size; 0 disables rotation.
+        unsigned maxRotatedFiles = 5;                ///< Keeps path.1 .. path.N.
+        FsyncPolicy fsync = FsyncPolicy::Interval;
+        std::chrono::milliseconds fsyncInterval{1000};
+        std::chrono::milliseconds maxPollInterval{50};   ///< Longest idle wait between looks at the ring.
+        /// Called on the writer thread whenever it opens an empty file, so a
+        /// format can start each file with a header. May be empty.
+        std::function<std::string()> fileHeader;
+    };
+
+    explicit AsyncLogWriter(std::string path) : AsyncLogWriter(std::move(path), Options()) {}
+
+    AsyncLogWriter(std::string path, Options options)
+        : m_path(std::move(path)), m_options(std::move(options)), m_ring(m_options.capacity) {
+        m_writer = std::thread([this] { writerLoop(); });
+    }
+
+    /// Writes out everything still queued, then stops the writer thread.
+    ~AsyncLogWriter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wake.notify_one();
+        m_writer.join();
+    }
+
+    AsyncLogWriter(const AsyncLogWriter &) = delete;
+    AsyncLogWriter &operator=(const AsyncLogWriter &) = delete;
+
+    /**
+     * @brief Queues one record (including any trailing newline).
+     * @return false if the ring was full and the record was dropped.
+     */
+    bool append(std::string record) {
+        if (!m_ring.tryPush(record)) {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        m_submitted.fetch_add(1, std::memory_order_release);
+        return true;
+    }
+
+    /// Blocks until every record queued before the call is written and, unless
+    /// the policy is Never, synced.
+    void flush() {
+        uint64_t target = m_submitted.load(std::memory_order_acquire);
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_flushRequested = true;
+        m_wake.notify_one();
+        m_flushed.wait(lock, [&] { return m_completed >= target; });
+    }
+
+    uint64_t droppedRecords() const { return m_dropped.load(std::memory_order_relaxed); }
+    const std::string &path() const { return m_path; }
+
+private:
+    std::string m_path;
+    Options m_options;
+    MpscRing<std::string> m_ring;
+    std::atomic<uint64_t> m_submitted{0};
+    std::atomic<uint64_t> m_dropped{0};
+
+    std::mutex m_mutex;                               // Guards the fields below
+    std::condition_variable m_wake;
+    std::condition_variable m_flushed;
+    uint64_t m_completed = 0;
+    bool m_stopping = false;
+    bool m_flushRequested = false;
+
+    std::FILE *m_file = nullptr;                      // Writer thread only
+    uint64_t m_fileBytes = 0;
+    bool m_unsynced = false;
+    std::chrono::milliseconds m_pollInterval{1};
+    std::chrono::steady_clock::time_point m_lastSync = std::chrono::steady_clock::now();
+    std::thread m_writer;
+
+    // Moves up to maxBatchRecords records into `batch`; returns how many.
+    size_t drain(std::string &batch) {
+        size_t count = 0;
+        auto take = [&batch](std::string &record) {
+            batch += record;
+            record.clear();
+        };
+        while (count < m_options.maxBatchRecords && m_ring.tryConsume(take))
+            ++count;
+        return count;
+    }
+
+    void writerLoop() {
+        std::string batch;
+        for (;;) {
+            batch.clear();
+            size_t count = drain(batch);
+            if (count > 0) {
+                m_pollInterval = std::chrono::milliseconds(1);
+                write(batch);
+                if (m_options.fsync == FsyncPolicy::EveryBatch)
+                    sync();
+            }
+            bool flushNow = false;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_completed += count;
+                if (count == 0) {
+                    if (m_stopping && !m_ring.hasQueued())
+                        break;
+                    flushNow = m_flushRequested;
+                    m_flushRequested = false;
+                    if (!flushNow) {
+                        m_wake.wait_for(lock, m_pollInterval, [this] { return m_stopping || m_flushRequested; });
+                        m_pollInterval = std::min(m_pollInterval * 2,
+                                                  std::max(m_options.maxPollInterval, std::chrono::milliseconds(1)));
+                    }
+                }
+            }
+            if (flushNow || (m_options.fsync == FsyncPolicy::Interval &&
+                             std::chrono::steady_clock::now() - m_lastSync >= m_options.fsyncInterval)) {
+                if (m_options.fsync != FsyncPolicy::Never)
+                    sync();
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_flushed.notify_all();
+            }
+        }
+        sync();
+        if (m_file)
+            std::fclose(m_file);
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_flushed.notify_all();
+    }
+
+    void write(const std::string &batch) {
+        if (m_file && m_options.maxFileBytes > 0 && m_fileBytes > 0 &&
+            m_fileBytes + batch.size() > m_options.maxFileBytes)
+            rotate();
+        if (!m_file)
+            open();
+        if (!m_file)
+            return;   // Unwritable: the batch is lost, the next one retries.
+        std::fwrite(batch.data(), 1, batch.size(), m_file);
+        std::fflush(m_file);
+        m_fileBytes += batch.size();
+        m_unsynced = true;
+    }
+
+    void open() {
+        m_file = std::fopen(m_path.c_str(), "ab");
+        if (!m_file)
+            return;
+        std::error_code error;
+        uintmax_t size = std::filesystem::file_size(m_path, error);
+        m_fileBytes = error ? 0 : size;
+        if (m_fileBytes == 0 && m_options.fileHeader) {
+            std::string header = m_options.fileHeader();
+            std::fwrite(header.data(), 1, header.size(), m_file);
+            m_fileBytes += header.size();
+        }
+    }
+
+    // path -> path.1 -> path.2 ... ; the oldest is overwritten.
+    void rotate() {
+        sync();
+        std::fclose(m_file);
+        m_file = nullptr;
+        std::error_code error;
+        for (unsigned i = m_options.maxRotatedFiles; i > 1; --i)
+            std::filesystem::rename(m_path + "." + std::to_string(i - 1), m_path + "." + std::to_string(i), error);
+        if (m_options.maxRotatedFiles > 0)
+            std::filesystem::rename(m_path, m_path + ".1", error);
+        else
+            std::filesystem::remove(m_path, error);
+    }
+
+    void sync() {
+        if (m_file && m_unsynced) {
+            std::fflush(m_file);
+#ifdef _WIN32
+            _commit(_fileno(m_file));
+#else
+            fsync(fileno(m_file));
+#endif
+        }
+        m_unsynced = false;
+        m_lastSync = std::chrono::steady_clock::now();
+    }
+};
+
+#endif // ASYNCLOGWRITER_H
@@ -0,0 +1,584 @@
+// Headless batch query tool: loads a knowledge base, answers a batch of
+// questions through the same ChatResponseGenerator the GUI uses (or straight
+// from a memory-mapped snapshot) and reports latency percentiles, throughput
+// and hit rate. Build with batchquery.pro.
+
+#include "KnowledgeBase.h"
+#include "ConversationLog.h"
+
+#include <iostream>
+#include <iomanip>
+#include <ctime>
+
+namespace {
+
+const char *const DEFAULT_KEY = "k1eFjP@7xL9qZ#5mR2tY8sA3vB6nC0wD";
+
+struct Options {
+    std::string kbFile;
+    std::string key = DEFAULT_KEY;
+    std::string snapshotFile;       // Answer from a MappedKnowledgeBase snapshot
+    std::vector<std::string> jsonFiles;
+    size_t syntheticEntries = 0;
+    size_t generatedQueries = 0;
+    std::string queryFile;          // Empty: read stdin
+    std::string replayLog;          // Binary conversation log to take queries from
+    uint64_t fromMs = 0;
+    uint64_t toMs = UINT64_MAX;
+    size_t topK = 0;                // 0: ChatResponseGenerator::generateResponse
+    size_t cacheCapacity = ChatResponseGenerator::DEFAULT_CACHE_CAPACITY;
+    std::string intentRules;        // Empty: built-in greeting/farewell rules
+    size_t threads = 1;
+    size_t repeat = 1;
+    bool exhaustive = false;
+    bool approximate = false;
+    uint32_t bands = 20;            // MinHash/LSH layout for --approximate
+    uint32_t rows = 5;
+    bool verify = false;
+    bool quiet = false;
+};
+
+void printUsage(const char *program) {
+    std::cerr <<
+        "Usage: " << program << " [options] [queries.txt]\n"
+        "Answers one question per line from the file (or stdin) and reports\n"
+        "latency percentiles, QPS and hit rate on stderr.\n\n"
+        "  --kb FILE         Encrypted knowledge base to load (default: a temporary one)\n"
+        "  --key KEY         Knowledge-base encryption key\n"
+        "  --snapshot FILE   Answer with findTopK from a memory-mapped snapshot; it is\n"
+        "                    first rewritten from the knowledge base when --kb, --json\n"
+        "                    or --synthetic is given, otherwise only the snapshot is opened\n"
+        "  --json FILE       Import a JSON training file first (repeatable)\n"
+        "  --synthetic N     Add N deterministic synthetic entries\n"
+        "  --generate N      Generate N queries from the loaded entries instead of reading them\n"
+        "  --replay LOG      Replay the user messages of a binary conversation log\n"
+        "  --from TIME       Only replay messages at or after TIME\n"
+        "  --to TIME         Only replay messages before TIME\n"
+        "  --top K           Query KnowledgeBase::findTopK(K) instead of the response generator\n"
+        "  --cache N         Response generator answer cache entries (default 4096, 0 disables)\n"
+        "  --intents FILE    Intent rules for the response generator\n"
+        "  --threads N       Run queries on N threads (default 1)\n"
+        "  --repeat N        Run the query set N times (default 1)\n"
+        "  --exhaustive      Use parallel exhaustive matching\n"
+        "  --approximate     Use MinHash/LSH approximate matching, then rerun the queries\n"
+        "                    with exhaustive matching and report recall@K (K from --top,\n"
+        "                    default 5) and latency for both\n"
+        "  --bands N         LSH bands for --approximate (default 20)\n"
+        "  --rows N          MinHash rows per band for --approximate (default 5)\n"
+        "  --verify          Check every findTopK(K) result (K from --top, default 5)\n"
+        "                    against a brute-force scan; exit status 1 on any mismatch\n"
+        "  --quiet           Do not print answers\n"
+        "\nTIME is milliseconds since the epoch or local \"YYYY-MM-DD[ HH:MM[:SS]]\".\n"
+        "Imports are written to the --kb file, so point it at a copy.\n";
+}
+
+size_t parseCount(const std::string &text) {
+    size_t used = 0;
+    unsigned long long value = std::stoull(text, &used);
+    if (used != text.size())
+        throw std::invalid_argument("not a number: " + text);
+    return static_cast<size_t>(value);
+}
+
+uint64_t parseTime(const std::string &text) {
+    if (!text.empty() && std::all_of(text.begin(), text.end(), [](unsigned char c) { return std::isdigit(c); }))
+        return parseCount(text);
+    std::tm tm = {};
+    std::string normalized = text;
+    std::replace(normalized.begin(), normalized.end(), 'T', ' ');
+    std::istringstream in(normalized);
+    in >> std::get_time(&tm, "%Y-%m-%d");
+    std::string timeOfDay;
+    if (!in.fail() && !in.eof())
+        std::getline(in, timeOfDay);
+    if (!in.fail() && !timeOfDay.empty()) {
+        std::istringstream time(timeOfDay);
+        time >> std::get_time(&tm, std::count(timeOfDay.begin(), timeOfDay.end(), ':') == 2 ? " %H:%M:%S" : " %H:%M");
+        if (time.fail() || time.peek() != std::char_traits<char>::eof())
+            in.setstate(std::ios::failbit);
+    }
+    if (in.fail())
+        throw std::invalid_argument("not a time: " + text);
+    tm.tm_isdst = -1;
+    std::time_t seconds = std::mktime(&tm);
+    if (seconds < 0)
+        throw std::invalid_argument("not a time: " + text);
+    return static_cast<uint64_t>(seconds) * 1000;
+}
+
+Options parseOptions(int argc, char *argv[]) {
+    Options options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc)
+                throw std::invalid_argument("missing value for " + arg);
+            return argv[++i];
+        };
+        if (arg == "--kb")
+            options.kbFile = value();
+        else if (arg == "--snapshot")
+            options.snapshotFile = value();
+        else if (arg == "--key")
+            options.key = value();
+        else if (arg == "--json")
+            options.jsonFiles.push_back(value());
+        else if (arg == "--synthetic")
+            options.syntheticEntries = parseCount(value());
+        else if (arg == "--generate")
+            options.generatedQueries = parseCount(value());
+        else if (arg == "--replay")
+            options.replayLog = value();
+        else if (arg == "--from")
+            options.fromMs = parseTime(value());
+        else if (arg == "--to")
+            options.toMs = parseTime(value());
+        else if (arg == "--intents")
+            options.intentRules = value();
+        else if (arg == "--cache")
+            options.cacheCapacity = parseCount(value());
+        else if (arg == "--top")
+            options.topK = parseCount(value());
+        else if (arg == "--threads")
+            options.threads = std::max<size_t>(1, parseCount(value()));
+        else if (arg == "--repeat")
+            options.repeat = std::max<size_t>(1, parseCount(value()));
+        else if (arg == "--exhaustive")
+            options.exhaustive = true;
+        else if (arg == "--approximate")
+            options.approximate = true;
+        else if (arg == "--bands")
+            options.bands = static_cast<uint32_t>(std::max<size_t>(1, parseCount(value())));
+        else if (arg == "--rows")
+            options.rows = static_cast<uint32_t>(std::max<size_t>(1, parseCount(value())));
+        else if (arg == "--verify")
+            options.verify = true;
+        else if (arg == "--quiet")
+            options.quiet = true;
+        else if (!arg.empty() && arg[0] == '-' && arg != "-")
+            throw std::invalid_argument("unknown option " + arg);
+        else
+            options.queryFile = arg == "-" ? std::string() : arg;
+    }
+    if (!options.snapshotFile.empty() && (options.exhaustive || options.approximate))
+        throw std::invalid_argument("--snapshot cannot be combined with --exhaustive or --approximate");
+    return options;
+}
+
+// -----------------------------
+// Data Sources
+// -----------------------------
+size_t importJSON(KnowledgeBase &kb, const std::string &path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in)
+        throw std::runtime_error("cannot open " + path);
+    JsonEntryReader reader;
+    IngestBatch batch;
+    size_t count = 0;
+    auto onEntry = [&](std::string_view question, std::string_view answer) {
+        batch.add(question, answer);
+        ++count;
+        if (batch.size() == 4096) {
+            kb.addEntries(batch.entries());
+            batch.clear();
+        }
+    };
+    std::vector<char> block(Cryptography::BLOCK_SIZE);
+    while (in.read(block.data(), static_cast<std::streamsize>(block.size())) || in.gcount() > 0)
+        reader.append(block.data(), static_cast<size_t>(in.gcount()), onEntry);
+    reader.finish();
+    kb.addEntries(batch.entries());
+    return count;
+}
+
+// Entries of 3-10 words drawn from a 5000-word vocabulary, fixed seed.
+void addSyntheticEntries(KnowledgeBase &kb, size_t count) {
+    std::mt19937 gen(42);
+    IngestBatch batch;
+    std::string question;
+    for (size_t i = 0; i < count; ++i) {
+        question.clear();
+        int words = 3 + static_cast<int>(gen() % 8);
+        for (int w = 0; w < words; ++w) {
+            if (w > 0)
+                question += ' ';
+            question += 'w';
+            question += std::to_string(gen() % 5000);
+        }
+        batch.add(question, "synthetic answer " + std::to_string(i));
+        if (batch.size() == 4096) {
+            kb.addEntries(batch.entries());
+            batch.clear();
+        }
+    }
+    kb.addEntries(batch.entries());
+}
+
+// A third each of exact questions, questions with one word changed and
+// questions with an extra unknown word; fixed seed.
+std::vector<std::string> generateQueries(const std::vector<std::string> &questions, size_t count) {
+    std::vector<std::string> queries;
+    if (questions.empty())
+        return queries;
+    std::mt19937 gen(7);
+    queries.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        std::string query = questions[gen() % questions.size()];
+        switch (i % 3) {
+        case 1: {
+            size_t space = query.rfind(' ');
+            query = (space == std::string::npos ? std::string() : query.substr(0, space + 1)) +
+                    "x" + std::to_string(gen() % 5000);
+            break;
+        }
+        case 2:
+            query += " unknown" + std::to_string(gen() % 5000);
+            break;
+        default:
+            break;
+        }
+        queries.push_back(std::move(query));
+    }
+    return queries;
+}
+
+// User messages in [fromMs, toMs) of a binary conversation log, in order.
+std::vector<std::string> replayQueries(const Options &options) {
+    ConversationLogReader reader(options.replayLog);
+    std::vector<std::string> queries;
+    size_t records = reader.replay(options.fromMs, options.toMs, [&queries](const ConversationLog::Record &record) {
+        if (record.role == ConversationLog::Role::User)
+            queries.push_back(record.text);
+    });
+    std::cerr << "Replayed " << queries.size() << " user messages (" << records << " records) from "
+              << options.replayLog << "\n";
+    return queries;
+}
+
+std::vector<std::string> readQueries(std::istream &in) {
+    std::vector<std::string> queries;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (!line.empty())
+            queries.push_back(line);
+    }
+    return queries;
+}
+
+void removeKnowledgeBaseFiles(const std::string &path) {
+    std::error_code error;
+    for (const char *suffix : {"", ".journal", ".journal.sealed", ".tmp"})
+        std::filesystem::remove(path + suffix, error);
+}
+
+// -----------------------------
+// Verification
+// -----------------------------
+using Ranked = std::vector<std::pair<uint32_t, double>>;   // Entry id, score; best first
+
+// Entry ids by word, so the brute-force scan can skip entries that share no
+// word with the query: those score 0 whatever the matcher does.
+using WordEntries = std::unordered_map<std::string, std::vector<uint32_t>>;
+
+WordEntries entriesByWord(const std::vector<std::string> &questions) {
+    WordEntries entries;
+    for (uint32_t entryId = 0; entryId < questions.size(); ++entryId)
+        for (const std::string &word : TextProcessor::tokenize(questions[entryId]))
+            if (entries[word].empty() || entries[word].back() != entryId)
+                entries[word].push_back(entryId);
+    return entries;
+}
+
+// The findTopK contract recomputed from scratch: an exact hit first, then every
+// other entry scored with the string form of calculateSimilarity, ranked by
+// score and then entry id.
+Ranked bruteForceTopK(const std::vector<std::string> &questions, const WordEntries &words,
+                      const std::string &query, size_t k) {
+    const double SIMILARITY_THRESHOLD = 0.8;
+    std::string normalizedQuery = TextProcessor::normalizeString(query);
+    Ranked ranked;
+    if (k == 0)
+        return ranked;
+    for (uint32_t entryId = 0; entryId < questions.size(); ++entryId) {
+        if (questions[entryId] == normalizedQuery) {
+            ranked.emplace_back(entryId, 1.0);
+            break;
+        }
+    }
+    std::vector<uint32_t> sharing;
+    for (const std::string &word : TextProcessor::tokenize(normalizedQuery)) {
+        auto found = words.find(word);
+        if (found != words.end())
+            sharing.insert(sharing.end(), found->second.begin(), found->second.end());
+    }
+    std::sort(sharing.begin(), sharing.end());
+    sharing.erase(std::unique(sharing.begin(), sharing.end()), sharing.end());
+    Ranked fuzzy;
+    for (uint32_t entryId : sharing) {
+        if (!ranked.empty() && ranked.front().first == entryId)
+            continue;
+        double score = TextProcessor::calculateSimilarity(normalizedQuery, questions[entryId]);
+        if (score > SIMILARITY_THRESHOLD)
+            fuzzy.emplace_back(entryId, score);
+    }
+    std::stable_sort(fuzzy.begin(), fuzzy.end(), [](const auto &a, const auto &b) { return a.second > b.second; });
+    for (const auto &match : fuzzy)
+        if (ranked.size() < k)
+            ranked.push_back(match);
+    return ranked;
+}
+
+// Returns the number of queries whose ranked ids or scores differ from the
+// brute-force scan, printing the first few.
+size_t verifyTopK(const std::vector<std::string> &questions, const std::vector<std::string> &queries, size_t k,
+                  const std::function<Ranked(const std::string &)> &topK) {
+    WordEntries words = entriesByWord(questions);
+    size_t mismatches = 0;
+    for (const std::string &query : queries) {
+        Ranked expected = bruteForceTopK(questions, words, query, k);
+        Ranked actual = topK(query);
+        bool same = expected.size() == actual.size();
+        for (size_t i = 0; same && i < expected.size(); ++i)
+            same = expected[i].first == actual[i].first && std::abs(expected[i].second - actual[i].second) < 1e-12;
+        if (same)
+            continue;
+        if (++mismatches <= 10) {
+            std::cerr << std::defaultfloat << std::setprecision(6) << "Mismatch for \"" << query << "\":\n  expected";
+            for (const auto &match : expected)
+                std::cerr << " " << match.first << "@" << match.second;
+            std::cerr << "\n  actual  ";
+            for (const auto &match : actual)
+                std::cerr << " " << match.first << "@" << match.second;
+            std::cerr << "\n";
+        }
+    }
+    return mismatches;
+}
+
+double percentile(const std::vector<double> &sorted, double p) {
+    if (sorted.empty())
+        return 0.0;
+    size_t rank = static_cast<size_t>(std::ceil(p * sorted.size()));
+    return sorted[std::min(sorted.size(), std::max<size_t>(rank, 1)) - 1];
+}
+
+void printLatencies(const char *label, std::vector<double> latencies) {
+    std::sort(latencies.begin(), latencies.end());
+    std::cerr << std::fixed << std::setprecision(1) << label << " latency (us): p50 " << percentile(latencies, 0.50)
+              << "  p95 " << percentile(latencies, 0.95)
+              << "  p99 " << percentile(latencies, 0.99)
+              << "  max " << (latencies.empty() ? 0.0 : latencies.back()) << "\n";
+}
+
+// Runs the queries through findTopK(k) in the current approximate mode, then
+// again with exhaustive matching, and reports the share of exhaustive matches
+// the approximate index found along with both latency distributions. Leaves
+// the knowledge base in approximate mode.
+void reportRecall(KnowledgeBase &kb, const std::vector<std::string> &queries, size_t k, const Options &options) {
+    using Clock = std::chrono::steady_clock;
+    auto run = [&](std::vector<std::vector<uint32_t>> &results, std::vector<double> &latencies) {
+        for (const std::string &query : queries) {
+            auto start = Clock::now();
+            std::vector<AnswerMatch> matches = kb.findTopK(query, k);
+            latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - start).count());
+            results.emplace_back();
+            for (const auto &match : matches)
+                results.back().push_back(match.entryId);
+        }
+    };
+    std::vector<std::vector<uint32_t>> approximate, exact;
+    std::vector<double> approximateLatencies, exactLatencies;
+    run(approximate, approximateLatencies);
+    kb.enableExhaustiveMatching();
+    run(exact, exactLatencies);
+    kb.enableApproximateMatching(options.bands, options.rows);
+    
+    size_t relevant = 0, found = 0;
+    for (size_t i = 0; i < queries.size(); ++i) {
+        relevant += exact[i].size();
+        for (uint32_t entryId : exact[i])
+            found += std::count(approximate[i].begin(), approximate[i].end(), entryId);
+    }
+    std::cerr << std::fixed << std::setprecision(1) << "Recall@" << k << " (" << options.bands << " bands x "
+              << options.rows << " rows): " << (relevant ? 100.0 * found / relevant : 100.0) << "% of "
+              << relevant << " exhaustive matches over " << queries.size() << " queries\n";
+    printLatencies("Approximate", std::move(approximateLatencies));
+    printLatencies("Exhaustive", std::move(exactLatencies));
+}
+
+} // namespace
+
+int main(int argc, char *argv[]) {
+    Options options;
+    try {
+        options = parseOptions(argc, argv);
+    } catch (const std::exception &e) {
+        std::cerr << "batchquery: " << e.what() << "\n";
+        printUsage(argv[0]);
+        return 2;
+    }
+
+    bool snapshotOnly = !options.snapshotFile.empty() && options.kbFile.empty() &&
+                        options.jsonFiles.empty() && options.syntheticEntries == 0;
+    bool temporaryKb = options.kbFile.empty() && !snapshotOnly;
+    if (temporaryKb) {
+        options.kbFile = (std::filesystem::temp_directory_path() /
+                          ("batchquery_" + std::to_string(std::random_device{}()) + ".dat")).string();
+        removeKnowledgeBaseFiles(options.kbFile);
+    }
+
+    int status = 0;
+    try {
+        using Clock = std::chrono::steady_clock;
+        std::shared_ptr<KnowledgeBase> kb;
+        if (!snapshotOnly) {
+            auto loadStart = Clock::now();
+            kb = std::make_shared<KnowledgeBase>(options.kbFile, options.key);
+            for (const auto &path : options.jsonFiles)
+                std::cerr << "Imported " << importJSON(*kb, path) << " entries from " << path << "\n";
+            if (options.syntheticEntries > 0)
+                addSyntheticEntries(*kb, options.syntheticEntries);
+            if (options.exhaustive)
+                kb->enableExhaustiveMatching();
+            else if (options.approximate)
+                kb->enableApproximateMatching(options.bands, options.rows);
+            double loadSeconds = std::chrono::duration<double>(Clock::now() - loadStart).count();
+            std::cerr << "Knowledge base: " << kb->size() << " entries, ready in "
+                      << std::fixed << std::setprecision(3) << loadSeconds << " s\n";
+        }
+        std::unique_ptr<MappedKnowledgeBase> snapshot;
+        if (!options.snapshotFile.empty()) {
+            if (kb) {
+                kb->setMappedSnapshot(options.snapshotFile);
+                kb->compact();
+            }
+            auto mapStart = Clock::now();
+            snapshot = std::make_unique<MappedKnowledgeBase>(options.snapshotFile);
+            double mapSeconds = std::chrono::duration<double>(Clock::now() - mapStart).count();
+            std::cerr << "Snapshot: " << snapshot->size() << " entries, mapped in "
+                      << std::fixed << std::setprecision(6) << mapSeconds << " s\n";
+        }
+
+        auto allQuestions = [&]() {
+            std::vector<std::string> questions;
+            if (snapshot) {
+                for (uint32_t entryId = 0; entryId < snapshot->size(); ++entryId)
+                    questions.emplace_back(snapshot->question(entryId));
+            } else {
+                kb->forEachEntry([&questions](std::string_view question, std::string_view) {
+                    questions.emplace_back(question);
+                });
+            }
+            return questions;
+        };
+
+        std::vector<std::string> queries;
+        if (options.generatedQueries > 0) {
+            queries = generateQueries(allQuestions(), options.generatedQueries);
+        } else if (!options.replayLog.empty()) {
+            queries = replayQueries(options);
+        } else if (!options.queryFile.empty()) {
+            std::ifstream in(options.queryFile);
+            if (!in)
+                throw std::runtime_error("cannot open " + options.queryFile);
+            queries = readQueries(in);
+        } else {
+            queries = readQueries(std::cin);
+        }
+
+        std::shared_ptr<const IntentMatcher> intents;
+        if (!options.intentRules.empty())
+            intents = std::make_shared<IntentMatcher>(IntentRules::load(options.intentRules));
+        std::optional<ChatResponseGenerator> generator;
+        if (!snapshot && options.topK == 0)
+            generator.emplace(kb, options.cacheCapacity, intents);
+        const size_t total = queries.size() * options.repeat;
+        std::vector<double> latencies(total);       // Microseconds, in query order
+        std::vector<std::string> answers(queries.size());
+        std::vector<char> hits(total, 0);
+        auto runSlice = [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; ++i) {
+                const std::string &query = queries[i % queries.size()];
+                auto start = Clock::now();
+                std::string answer;
+                if (snapshot) {
+                    std::vector<MappedMatch> matches = snapshot->findTopK(query, std::max<size_t>(options.topK, 1));
+                    if (!matches.empty())
+                        answer = std::string(matches.front().answer);
+                } else if (generator) {
+                    answer = generator->generateResponse(query);
+                } else {
+                    std::vector<AnswerMatch> matches = kb->findTopK(query, options.topK);
+                    if (!matches.empty())
+                        answer = matches.front().answer;
+                }
+                latencies[i] = std::chrono::duration<double, std::micro>(Clock::now() - start).count();
+                hits[i] = !answer.empty();
+                if (i < queries.size())
+                    answers[i] = std::move(answer);
+            }
+        };
+
+        auto runStart = Clock::now();
+        std::vector<std::thread> workers;
+        for (size_t t = 1; t < options.threads; ++t)
+            workers.emplace_back(runSlice, total * t / options.threads, total * (t + 1) / options.threads);
+        runSlice(0, total / options.threads);
+        for (auto &worker : workers)
+            worker.join();
+        double runSeconds = std::chrono::duration<double>(Clock::now() - runStart).count();
+
+        if (!options.quiet)
+            for (size_t i = 0; i < queries.size(); ++i)
+                std::cout << queries[i] << "\t" << answers[i] << "\n";
+
+        size_t hitCount = static_cast<size_t>(std::count(hits.begin(), hits.end(), 1));
+        std::sort(latencies.begin(), latencies.end());
+        std::cerr << std::fixed << std::setprecision(1)
+                  << "Queries: " << total << " on " << options.threads << " thread(s)"
+                  << "  hits: " << hitCount << " (" << (total ? 100.0 * hitCount / total : 0.0) << "%)\n"
+                  << "QPS: " << (runSeconds > 0 ? total / runSeconds : 0.0)
+                  << "  wall: " << std::setprecision(3) << runSeconds << " s\n" << std::setprecision(1)
+                  << "Latency (us): p50 " << percentile(latencies, 0.50)
+                  << "  p95 " << percentile(latencies, 0.95)
+                  << "  p99 " << percentile(latencies, 0.99)
+                  << "  max " << (latencies.empty() ? 0.0 : latencies.back()) << "\n";
+        if (generator) {
+            AnswerCache::Stats cache = generator->cacheStats();
+            std::cerr << "Answer cache: " << cache.hits << " hits, " << cache.misses << " misses ("
+                      << 100.0 * cache.hitRatio() << "%), " << cache.entries << "/" << cache.capacity << " entries\n";
+        }
+
+        if (options.approximate)
+            reportRecall(*kb, queries, options.topK > 0 ? options.topK : 5, options);
+
+        if (options.verify) {
+            const size_t k = options.topK > 0 ? options.topK : 5;
+            auto topK = [&](const std::string &query) {
+                Ranked ranked;
+                if (snapshot) {
+                    for (const auto &match : snapshot->findTopK(query, k))
+                        ranked.emplace_back(match.entryId, match.score);
+                } else {
+                    for (const auto &match : kb->findTopK(query, k))
+                        ranked.emplace_back(match.entryId, match.score);
+                }
+                return ranked;
+            };
+            size_t mismatches = verifyTopK(allQuestions(), queries, k, topK);
+            std::cerr << "Verify: " << queries.size() << " queries against a brute-force top " << k
+                      << ", " << mismatches << " mismatches\n";
+            if (mismatches > 0)
+                status = 1;
+        }
+    } catch (const std::exception &e) {
+        std::cerr << "batchquery: " << e.what() << "\n";
+        status = 1;
+    }
+
+    if (temporaryKb)
+        removeKnowledgeBaseFiles(options.kbFile);
+    return status;
+}
@@ -1,25 +1,195 @@
 // ConcreteAIModel.cpp
 #include "AIModel.h"
-#include <chrono>
-#include <future>
+#include "NeuralNetwork.h"
+#include <condition_variable>
+#include <exception>
+#include <functional>
 #include <thread>
 #include <stdexcept>
+#include <cmath>
 #include <iostream>
 #include <mutex>
+#include <numeric>
+#include <random>
 #include <vector>
+#include <fstream>
+#include <string>
+#include <utility>
 
 // -------------------------------------------------
 // Concrete Optimizer Implementation (Strategy Pattern)
 // -------------------------------------------------
 
+static void checkOptimizerSpans(ParameterSpan parameters, GradientSpan gradients) {
+    if (parameters.size != gradients.size)
+        throw std::invalid_argument("Got " + std::to_string(gradients.size) + " gradients for " +
+                                    std::to_string(parameters.size) + " parameters");
+}
+
 /**
  * @brief Concrete implementation of an optimizer using Stochastic Gradient Descent (SGD).
  */
 class SGDOptimizer : public IOptimizer {
 public:
-    void optimize() override {
-        // Simulate an optimization step.
-        std::cout << "[Optimizer] Optimizing using Stochastic Gradient Descent (SGD)..." << std::endl;
+    explicit SGDOptimizer(float learningRate = 0.01f) : learningRate_(learningRate) {}
+
+    void optimize(ParameterSpan parameters, GradientSpan gradients, uint64_t) override {
+        checkOptimizerSpans(parameters, gradients);
+        OptimizerKernels::sgd(parameters.data, gradients.data, parameters.size, learningRate_);
+    }
+
+private:
+    float learningRate_;    ///< Step size.
+};
+
+/**
+ * @brief SGD with (heavy-ball) momentum: steps follow a decaying sum of past gradients.
+ */
+class MomentumOptimizer : public IOptimizer {
+public:
+    explicit MomentumOptimizer(float learningRate = 0.01f, float momentum = 0.9f)
+        : learningRate_(learningRate), momentum_(momentum) {}
+
+    void optimize(ParameterSpan parameters, GradientSpan gradients, uint64_t step) override {
+        checkOptimizerSpans(parameters, gradients);
+        if (step <= 1 || velocity_.size() != parameters.size)
+            velocity_.resize(parameters.size);
+        OptimizerKernels::momentum(parameters.data, gradients.data, velocity_.data(), parameters.size,
+                                   learningRate_, momentum_);
+    }
+
+private:
+    float learningRate_;                ///< Step size.
+    float momentum_;                    ///< Fraction of the velocity kept per step.
+    AlignedBuffer<float> velocity_;     ///< One entry per parameter.
+};
+
+/**
+ * @brief Adam: per-parameter step sizes from running estimates of the
+ * gradient's mean and variance, with bias correction for early steps.
+ */
+class AdamOptimizer : public IOptimizer {
+public:
+    explicit AdamOptimizer(float learningRate = 0.001f, float beta1 = 0.9f, float beta2 = 0.999f,
+                           float epsilon = 1e-8f)
+        : learningRate_(learningRate), beta1_(beta1), beta2_(beta2), epsilon_(epsilon) {}
+
+    void optimize(ParameterSpan parameters, GradientSpan gradients, uint64_t step) override {
+        checkOptimizerSpans(parameters, gradients);
+        if (step <= 1 || mean_.size() != parameters.size) {
+            mean_.resize(parameters.size);
+            variance_.resize(parameters.size);
+        }
+        double t = static_cast<double>(std::max<uint64_t>(step, 1));
+        double stepSize = learningRate_ * std::sqrt(1.0 - std::pow(beta2_, t)) / (1.0 - std::pow(beta1_, t));
+        OptimizerKernels::adam(parameters.data, gradients.data, mean_.data(), variance_.data(), parameters.size,
+                               static_cast<float>(stepSize), beta1_, beta2_, epsilon_);
+    }
+
+private:
+    float learningRate_;                ///< Base step size.
+    float beta1_;                       ///< Decay of the mean estimate.
+    float beta2_;                       ///< Decay of the variance estimate.
+    float epsilon_;                     ///< Keeps the denominator away from zero.
+    AlignedBuffer<float> mean_;         ///< First moment, one entry per parameter.
+    AlignedBuffer<float> variance_;     ///< Second moment, one entry per parameter.
+};
+
+// -------------------------------------------------
+// Worker Pool
+// -------------------------------------------------
+
+/**
+ * @brief Fixed set of threads that each run the same job and are waited for together.
+ *
+ * The calling thread acts as worker 0, so a pool of one runs jobs inline.
+ * Threads are started once and reused, so dispatching a job costs a wakeup,
+ * not a thread launch.
+ */
+class WorkerPool {
+public:
+    explicit WorkerPool(size_t workers) : workers_(std::max<size_t>(1, workers)) {
+        for (size_t worker = 1; worker < workers_; ++worker)
+            threads_.emplace_back([this, worker] { workerLoop(worker); });
+    }
+
+    ~WorkerPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        wake_.notify_all();
+        for (auto& thread : threads_)
+            thread.join();
+    }
+
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    size_t size() const { return workers_; }
+
+    /**
+     * @brief Runs job(worker) on every worker and returns once all have finished.
+     *
+     * If any of them throws, one of the exceptions is rethrown here.
+     */
+    void run(const std::function<void(size_t)>& job) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            job_ = &job;
+            pending_ = workers_ - 1;
+            ++generation_;
+        }
+        wake_.notify_all();
+        try {
+            job(0);
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!error_)
+                error_ = std::current_exception();
+        }
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [this] { return pending_ == 0; });
+        job_ = nullptr;
+        if (error_)
+            std::rethrow_exception(std::exchange(error_, nullptr));
+    }
+
+private:
+    size_t workers_;
+    std::vector<std::thread> threads_;
+    std::mutex mutex_;                                  ///< Guards the fields below.
+    std::condition_variable wake_;
+    std::condition_variable done_;
+    const std::function<void(size_t)>* job_ = nullptr;
+    uint64_t generation_ = 0;                           ///< Bumped for every job.
+    size_t pending_ = 0;                                ///< Helper threads still running the job.
+    std::exception_ptr error_;
+    bool stopping_ = false;
+
+    void workerLoop(size_t worker) {
+        uint64_t seen = 0;
+        for (;;) {
+            const std::function<void(size_t)>* job;
+            {
+                std::unique_lock<std::mutex> lock(mutex_);
+                wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+                if (stopping_)
+                    return;
+                seen = generation_;
+                job = job_;
+            }
+            try {
+                (*job)(worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(mutex_);
+                if (!error_)
+                    error_ = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (--pending_ == 0)
+                done_.notify_one();
+        }
     }
 };
 
@@ -30,8 +200,12 @@ public:
 /**
  * @brief Concrete implementation of a Neural Network AI model.
  *
- * This model simulates a multi-threaded training process.
- * In production, this would be replaced by actual computations.
+ * Inference runs a FeedForwardNetwork (see NeuralNetwork.h). The network is
+ * loaded from the weights file when it exists, otherwise built from the
+ * configured layer sizes with seeded random weights. train() runs mini-batch
+ * gradient descent on the samples given to setTrainingData(): mean squared
+ * error for a single output, softmax cross-entropy over class indices
+ * otherwise.
  */
 class NeuralNetworkModel : public AIModel {
 public:
@@ -39,106 +213,206 @@ public:
      * @brief Constructs a new NeuralNetworkModel object.
      *
      * @param name Unique model name.
-     * @param optimizer Unique pointer to an optimizer strategy.
-     * @param trainingEpochs Number of epochs to simulate.
-     * @param trainingDelay Delay per epoch to simulate workload.
-     * @param parallelTraining If true, epochs run concurrently.
+     * @param optimizer Unique pointer to an optimizer strategy; plain SGD if null.
+     * @param trainingEpochs Passes over the training data.
+     * @param batchSize Samples per gradient step.
+     * @param parallelTraining If true, each mini-batch is split across one
+     *        worker per hardware thread.
+     * @param layerSizes Input size followed by each layer's size, used when
+     *        there is no weights file.
+     * @param weightsFile Network saved with FeedForwardNetwork::save; may be empty.
      */
     NeuralNetworkModel(const std::string& name,
                        std::unique_ptr<IOptimizer> optimizer,
                        int trainingEpochs = 5,
-                       std::chrono::milliseconds trainingDelay = std::chrono::milliseconds(100),
-                       bool parallelTraining = false)
+                       size_t batchSize = 32,
+                       bool parallelTraining = false,
+                       std::vector<size_t> layerSizes = {16, 64, 64, 1},
+                       std::string weightsFile = std::string())
         : AIModel(name),
-          optimizer_(std::move(optimizer)),
+          optimizer_(optimizer ? std::move(optimizer) : std::make_unique<SGDOptimizer>()),
           trainingEpochs_(trainingEpochs),
-          trainingDelay_(trainingDelay),
-          parallelTraining_(parallelTraining) {}
+          batchSize_(std::max<size_t>(1, batchSize)),
+          parallelTraining_(parallelTraining),
+          layerSizes_(std::move(layerSizes)),
+          weightsFile_(std::move(weightsFile)) {}
 
     /**
      * @brief Initializes the neural network architecture and parameters.
      */
     void initialize() override {
         std::cout << "[NeuralNetworkModel] Initializing model: " << modelName << std::endl;
-        // Integration with external libraries would go here.
+        std::ifstream weights(weightsFile_, std::ios::binary);
+        if (!weightsFile_.empty() && weights) {
+            network_ = FeedForwardNetwork::load(weightsFile_);
+        } else {
+            network_ = FeedForwardNetwork(layerSizes_, Activation::ReLU, Activation::Identity);
+            network_.initializeWeights(RANDOM_SEED);
+        }
+        std::cout << "[NeuralNetworkModel] " << network_.layerCount() << " layers, "
+                  << network_.inputSize() << " inputs, " << network_.outputSize() << " outputs, "
+                  << (DenseKernels::usingAvx2() ? "AVX2/FMA" : "scalar") << " kernels" << std::endl;
+    }
+
+    /**
+     * @brief Sets the samples train() learns from; the data is copied.
+     * @param inputs One sample per row.
+     * @param targets inputs.rows values: the expected output for a
+     *        single-output network, otherwise the class index.
+     */
+    void setTrainingData(const SampleMatrix& inputs, const double* targets) {
+        trainingInputs_.assign(inputs.data, inputs.data + inputs.rows * inputs.columns);
+        trainingTargets_.assign(targets, targets + inputs.rows);
+        trainingColumns_ = inputs.columns;
     }
 
     /**
-     * @brief Trains the neural network model.
+     * @brief Trains the network with mini-batch gradient descent.
      *
-     * Simulates either a sequential or concurrent training
-     * process by using asynchronous tasks.
+     * Samples are shuffled every epoch with a fixed seed. Each mini-batch is
+     * split into one contiguous shard per worker; the workers compute their
+     * shard's gradients into private buffers, then sum the shards in worker
+     * order, each over its own slice of the parameters, and the optimizer
+     * applies the mean gradient. The result depends only on the data and the
+     * worker count, never on thread timing.
+     * Observers get the mean loss of every epoch. Must not run concurrently
+     * with predict().
      */
     void train() override {
-        notifyTrainingStart();
+        if (network_.layerCount() == 0)
+            throw std::logic_error("train() called before initialize() on " + modelName);
+        if (trainingTargets_.empty())
+            throw std::logic_error("No training data set for " + modelName);
+        if (trainingColumns_ != network_.inputSize())
+            throw std::invalid_argument("Expected " + std::to_string(network_.inputSize()) +
+                                        " features, got " + std::to_string(trainingColumns_));
 
-        if (parallelTraining_) {
-            // Launch all epoch tasks concurrently
-            std::vector<std::future<void>> futures;
-            for (int epoch = 1; epoch <= trainingEpochs_; ++epoch) {
-                futures.push_back(std::async(std::launch::async, [this, epoch]() {
-                    std::this_thread::sleep_for(trainingDelay_);
-                    try {
-                        if (optimizer_) {
-                            optimizer_->optimize();
-                        }
-                        double loss = 100.0 / epoch;  // Simulated decaying loss
-                        {
-                            std::lock_guard<std::mutex> lock(notificationMutex_);
-                            notifyTrainingProgress(epoch, loss);
-                        }
-                    } catch (const std::exception& e) {
-                        std::cerr << "[ERROR] Exception in epoch " << epoch << ": " << e.what() << std::endl;
-                    }
-                }));
-            }
-            // Wait for all epochs to complete
-            for (auto& fut : futures) {
-                fut.get();
-            }
-        } else {
-            // Sequential training: each epoch is processed one after the other.
-            for (int epoch = 1; epoch <= trainingEpochs_; ++epoch) {
-                try {
-                    std::this_thread::sleep_for(trainingDelay_);
-                    if (optimizer_) {
-                        optimizer_->optimize();
+        const size_t samples = trainingTargets_.size();
+        const size_t parameterCount = network_.parameterCount();
+        const Loss loss = network_.outputSize() == 1 ? Loss::MeanSquaredError : Loss::SoftmaxCrossEntropy;
+        WorkerPool pool(parallelTraining_ ? std::thread::hardware_concurrency() : 1);
+        const size_t workers = pool.size();
+
+        struct Shard {
+            AlignedBuffer<float> gradients;
+            FeedForwardNetwork::TrainingWorkspace workspace;
+            std::vector<float> inputs;
+            std::vector<float> targets;
+            double loss = 0.0;
+        };
+        std::vector<Shard> shards(workers);
+        for (Shard& shard : shards)
+            shard.gradients.resize(parameterCount);
+        AlignedBuffer<float> gradients(parameterCount);
+        std::vector<size_t> order(samples);
+        std::iota(order.begin(), order.end(), size_t(0));
+        std::mt19937_64 gen(RANDOM_SEED);
+        uint64_t step = 0;
+
+        notifyTrainingStart();
+        for (int epoch = 1; epoch <= trainingEpochs_; ++epoch) {
+            std::shuffle(order.begin(), order.end(), gen);
+            double epochLoss = 0.0;
+            for (size_t first = 0; first < samples; first += batchSize_) {
+                const size_t count = std::min(batchSize_, samples - first);
+                pool.run([&](size_t worker) {
+                    Shard& shard = shards[worker];
+                    std::fill(shard.gradients.data(), shard.gradients.data() + parameterCount, 0.0f);
+                    shard.loss = 0.0;
+                    const size_t begin = first + count * worker / workers;
+                    const size_t end = first + count * (worker + 1) / workers;
+                    if (begin == end)
+                        return;
+                    shard.inputs.resize((end - begin) * trainingColumns_);
+                    shard.targets.resize(end - begin);
+                    for (size_t i = begin; i < end; ++i) {
+                        const float* row = trainingInputs_.data() + order[i] * trainingColumns_;
+                        std::copy(row, row + trainingColumns_, shard.inputs.data() + (i - begin) * trainingColumns_);
+                        shard.targets[i - begin] = trainingTargets_[order[i]];
                     }
-                    double loss = 100.0 / epoch;
-                    {
-                        std::lock_guard<std::mutex> lock(notificationMutex_);
-                        notifyTrainingProgress(epoch, loss);
+                    shard.loss = network_.backpropagate(shard.inputs.data(), shard.targets.data(), end - begin,
+                                                        loss, shard.gradients.data(), shard.workspace);
+                });
+                const float scale = 1.0f / static_cast<float>(count);
+                pool.run([&](size_t worker) {
+                    const size_t blocks = parameterCount / DenseKernels::LANES;
+                    const size_t begin = blocks * worker / workers * DenseKernels::LANES;
+                    const size_t end = blocks * (worker + 1) / workers * DenseKernels::LANES;
+                    for (size_t i = begin; i < end; ++i) {
+                        float sum = shards[0].gradients[i];
+                        for (size_t w = 1; w < workers; ++w)
+                            sum += shards[w].gradients[i];
+                        gradients[i] = sum * scale;
                     }
-                } catch (const std::exception& e) {
-                    std::cerr << "[ERROR] Exception in epoch " << epoch << ": " << e.what() << std::endl;
-                }
+                });
+                for (const Shard& shard : shards)
+                    epochLoss += shard.loss;
+                optimizer_->optimize(ParameterSpan{network_.parameters(), parameterCount},
+                                     GradientSpan{gradients.data(), parameterCount}, ++step);
             }
+            notifyTrainingProgress(epoch, epochLoss / static_cast<double>(samples));
         }
-
         notifyTrainingEnd();
     }
 
     /**
-     * @brief Performs a simple prediction.
+     * @brief Runs the network on one sample.
      *
-     * For demonstration, this function returns the sum of the input values.
-     * @param input A vector of input features.
-     * @return The computed prediction.
+     * Safe to call from several threads; each keeps its own buffers.
+     * @param input A vector of inputSize() features.
+     * @return The output for a single-output network, otherwise the index of
+     *         the largest output (the predicted class).
      */
     double predict(const std::vector<double>& input) override {
-        double result = 0.0;
-        for (double val : input) {
-            result += val;
+        double prediction = 0.0;
+        predictBatch(SampleMatrix{input.data(), 1, input.size()}, &prediction);
+        return prediction;
+    }
+
+    /**
+     * @brief Runs the network on a batch of samples.
+     *
+     * Samples are evaluated together, up to MAX_BATCH at a time, so each
+     * weight block is loaded once per group of samples instead of once per
+     * sample. Predictions are as for predict().
+     */
+    void predictBatch(const SampleMatrix& inputs, double* outputs) override {
+        if (network_.layerCount() == 0)
+            throw std::logic_error("predict() called before initialize() on " + modelName);
+        if (inputs.columns != network_.inputSize())
+            throw std::invalid_argument("Expected " + std::to_string(network_.inputSize()) +
+                                        " features, got " + std::to_string(inputs.columns));
+        thread_local FeedForwardNetwork::Workspace workspace;
+        thread_local std::vector<float> features, results;
+        const size_t outputSize = network_.outputSize();
+        for (size_t first = 0; first < inputs.rows; first += MAX_BATCH) {
+            const size_t count = std::min(MAX_BATCH, inputs.rows - first);
+            features.assign(inputs.row(first), inputs.row(first + count));
+            results.resize(count * outputSize);
+            network_.forward(features.data(), count, results.data(), workspace);
+            for (size_t i = 0; i < count; ++i) {
+                const float* result = results.data() + i * outputSize;
+                outputs[first + i] = outputSize == 1
+                    ? result[0]
+                    : static_cast<double>(std::max_element(result, result + outputSize) - result);
+            }
         }
-        return result;
     }
 
 private:
     std::unique_ptr<IOptimizer> optimizer_;       ///< Optimizer strategy for training.
     int trainingEpochs_;                            ///< Total number of training epochs.
-    std::chrono::milliseconds trainingDelay_;       ///< Simulated delay per epoch.
-    bool parallelTraining_;                         ///< Toggle for concurrent training simulation.
-    std::mutex notificationMutex_;                  ///< Ensures thread-safe notifications.
+    size_t batchSize_;                              ///< Samples per gradient step.
+    bool parallelTraining_;                         ///< Split mini-batches across hardware threads.
+    std::vector<size_t> layerSizes_;                ///< Architecture used without a weights file.
+    std::string weightsFile_;                       ///< Saved network to load, if present.
+    FeedForwardNetwork network_;                    ///< Inference network.
+    std::vector<float> trainingInputs_;             ///< Training samples, row-major.
+    std::vector<float> trainingTargets_;            ///< One target per training sample.
+    size_t trainingColumns_ = 0;                    ///< Features per training sample.
+
+    static constexpr uint64_t RANDOM_SEED = 42;     ///< Seed for initial weights and shuffling.
+    static constexpr size_t MAX_BATCH = 256;        ///< Samples per forward pass in predictBatch.
 };
 
 // -------------------------------------------------
@@ -149,23 +423,51 @@ private:
  * @brief Concrete factory for creating AI model instances.
  *
  * This factory uses a string identifier to instantiate the appropriate model type.
+ * Models it creates train with the optimizer named at construction.
  */
 class ConcreteAIModelFactory : public AIModelFactory {
 public:
+    /**
+     * @param optimizerType "SGD", "Momentum" or "Adam".
+     */
+    explicit ConcreteAIModelFactory(std::string optimizerType = "SGD")
+        : optimizerType_(std::move(optimizerType)) {
+        createOptimizer(optimizerType_);   // Reject unknown names up front.
+    }
+
+    /**
+     * @brief Create an optimizer with its default hyperparameters.
+     * @param optimizerType "SGD", "Momentum" or "Adam".
+     */
+    static std::unique_ptr<IOptimizer> createOptimizer(const std::string& optimizerType) {
+        if (optimizerType == "SGD")
+            return std::make_unique<SGDOptimizer>();
+        if (optimizerType == "Momentum")
+            return std::make_unique<MomentumOptimizer>();
+        if (optimizerType == "Adam")
+            return std::make_unique<AdamOptimizer>();
+        throw std::invalid_argument("Unknown optimizer type: " + optimizerType);
+    }
+
     std::unique_ptr<AIModel> createModel(const std::string& modelType) override {
         if (modelType == "NeuralNetwork") {
             // You can adjust parameters such as the number of epochs,
-            // delay, or the parallel flag as needed.
+            // batch size, or the parallel flag as needed.
             return std::make_unique<NeuralNetworkModel>(
                 "NeuralNetModel",
-                std::make_unique<SGDOptimizer>(),
+                createOptimizer(optimizerType_),
                 5,                            // epochs
-                std::chrono::milliseconds(100), // delay
-                true                          // run epochs in parallel
+                32,                           // mini-batch size
+                true,                         // split mini-batches across cores
+                std::vector<size_t>{16, 64, 64, 1}, // layer sizes without a weights file
+                "neural_network.nnw"          // weights file, loaded if present
             );
         }
         throw std::invalid_argument("Unknown model type: " + modelType);
     }
+
+private:
+    std::string optimizerType_;     ///< Optimizer given to every created model.
 };
 
 // -------------------------------------------------
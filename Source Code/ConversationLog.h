@@ -0,0 +1,329 @@
+#ifndef CONVERSATIONLOG_H
+#define CONVERSATIONLOG_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// ===========================
+// Binary Conversation Log
+// ===========================
+
+/**
+ * @brief Compact binary format for the conversation log.
+ *
+ * A file starts with an 8-byte header and holds a sequence of records:
+ *
+ *   record: [varint timestamp ms since epoch][u8 role][varint length][UTF-8 text]
+ *   sync:   [SYNC_MARKER, 8 bytes][varint timestamp ms]
+ *
+ * Sync points are written every SYNC_INTERVAL_RECORDS records or
+ * SYNC_INTERVAL_MS milliseconds and form the time index: a reader binary
+ * searches the file by byte offset, realigns on the next marker and compares
+ * its timestamp, so seeking to a time range reads only a few blocks.
+ * Timestamps are absolute, which keeps every rotated file decodable on its own.
+ * A marker cannot start a record (its third byte would end a three-byte
+ * timestamp varint, i.e. a time in January 1970, and 'X' is not a role), and
+ * text must be valid UTF-8, which never contains 0xFF. It can still occur
+ * inside a record's length varint followed by the text, e.g. a 1294207-byte
+ * text starting with "XSYNC", so a reader realigning mid-file only accepts a
+ * marker followed by the record the encoder writes with it: same timestamp,
+ * valid role. That rules out chance matches, not text crafted to imitate a
+ * sync point.
+ */
+class ConversationLog {
+public:
+    enum class Role : uint8_t {
+        User = 1,
+        Bot = 2,
+        Reminder = 3,
+        System = 4
+    };
+
+    struct Record {
+        uint64_t timestampMs = 0;
+        Role role = Role::User;
+        std::string text;
+    };
+
+    static constexpr char FILE_MAGIC[8] = {'N', 'X', 'C', 'L', 'O', 'G', 1, 0};
+    static constexpr unsigned char SYNC_MARKER[8] = {0xFF, 0xFE, 'N', 'X', 'S', 'Y', 'N', 'C'};
+    static constexpr size_t SYNC_INTERVAL_RECORDS = 256;
+    static constexpr uint64_t SYNC_INTERVAL_MS = 60 * 1000;
+
+    static std::string fileHeader() { return std::string(FILE_MAGIC, sizeof(FILE_MAGIC)); }
+
+    static uint64_t nowMs() {
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count());
+    }
+
+    static const char *roleName(Role role) {
+        switch (role) {
+        case Role::User: return "User";
+        case Role::Bot: return "Bot";
+        case Role::Reminder: return "Bot (reminder)";
+        case Role::System: return "System";
+        }
+        return "Unknown";
+    }
+
+    static void appendVarint(std::string &out, uint64_t value) {
+        while (value >= 0x80) {
+            out += static_cast<char>((value & 0x7F) | 0x80);
+            value >>= 7;
+        }
+        out += static_cast<char>(value);
+    }
+};
+
+// Builds records for one writer. Not thread-safe; the GUI thread owns it.
+class ConversationLogEncoder {
+public:
+    /// Encodes one record, preceded by a sync point when one is due.
+    /// Timestamps are clamped so they never go backwards within a session.
+    std::string encode(uint64_t timestampMs, ConversationLog::Role role, std::string_view text) {
+        timestampMs = std::max(timestampMs, m_lastTimestamp);
+        m_lastTimestamp = timestampMs;
+        std::string record;
+        record.reserve(text.size() + 32);
+        if (m_recordsSinceSync == 0 || m_recordsSinceSync >= ConversationLog::SYNC_INTERVAL_RECORDS ||
+            timestampMs - m_lastSync >= ConversationLog::SYNC_INTERVAL_MS) {
+            record.append(reinterpret_cast<const char *>(ConversationLog::SYNC_MARKER),
+                          sizeof(ConversationLog::SYNC_MARKER));
+            ConversationLog::appendVarint(record, timestampMs);
+            m_recordsSinceSync = 0;
+            m_lastSync = timestampMs;
+        }
+        ConversationLog::appendVarint(record, timestampMs);
+        record += static_cast<char>(role);
+        ConversationLog::appendVarint(record, text.size());
+        record.append(text.data(), text.size());
+        ++m_recordsSinceSync;
+        return record;
+    }
+
+private:
+    uint64_t m_lastTimestamp = 0;
+    uint64_t m_lastSync = 0;
+    size_t m_recordsSinceSync = 0;
+};
+
+/**
+ * @brief Sequential reader with time-range seeking.
+ *
+ * A record cut short at the end of the file (the writer was killed mid-batch)
+ * reads as end of file; anything else malformed throws std::runtime_error with
+ * the byte offset.
+ */
+class ConversationLogReader {
+public:
+    explicit ConversationLogReader(const std::string &path) : m_in(path, std::ios::binary) {
+        if (!m_in)
+            throw std::runtime_error("Cannot open conversation log " + path);
+        m_in.seekg(0, std::ios::end);
+        m_size = static_cast<uint64_t>(m_in.tellg());
+        char magic[sizeof(ConversationLog::FILE_MAGIC)] = {};
+        m_in.seekg(0);
+        if (!m_in.read(magic, sizeof(magic)) ||
+            std::memcmp(magic, ConversationLog::FILE_MAGIC, sizeof(magic)) != 0)
+            throw std::runtime_error("Not a binary conversation log: " + path);
+        seekOffset(sizeof(magic));
+    }
+
+    /**
+     * @brief Positions the reader so the next records include every record at
+     * or after `fromMs`. Earlier records up to one sync interval may precede them.
+     */
+    void seek(uint64_t fromMs) {
+        uint64_t best = sizeof(ConversationLog::FILE_MAGIC);
+        uint64_t lo = best, hi = m_size;
+        while (lo < hi) {
+            uint64_t mid = lo + (hi - lo) / 2;
+            uint64_t offset = 0, timestamp = 0;
+            if (!findSync(mid, hi, offset, timestamp) || timestamp >= fromMs) {
+                hi = mid;
+            } else {
+                best = offset;
+                lo = offset + sizeof(ConversationLog::SYNC_MARKER);
+            }
+        }
+        seekOffset(best);
+    }
+
+    /// Reads the next record; returns false at end of file.
+    bool next(ConversationLog::Record &record) {
+        for (;;) {
+            uint64_t start = m_offset;
+            if (!fill(1))
+                return false;
+            if (fill(sizeof(ConversationLog::SYNC_MARKER)) &&
+                std::memcmp(m_buffer.data() + m_pos, ConversationLog::SYNC_MARKER,
+                            sizeof(ConversationLog::SYNC_MARKER)) == 0) {
+                consume(sizeof(ConversationLog::SYNC_MARKER));
+                uint64_t ignored;
+                if (!readVarint(ignored))
+                    return false;
+                continue;
+            }
+            uint64_t timestamp, length;
+            if (!readVarint(timestamp) || !fill(1))
+                return false;
+            uint8_t role = static_cast<uint8_t>(m_buffer[m_pos]);
+            if (role < static_cast<uint8_t>(ConversationLog::Role::User) ||
+                role > static_cast<uint8_t>(ConversationLog::Role::System))
+                throw std::runtime_error("Corrupt conversation log record at offset " + std::to_string(start));
+            consume(1);
+            if (!readVarint(length))
+                return false;
+            if (length > m_size - std::min(m_size, m_offset))
+                return false;   // Truncated tail
+            record.timestampMs = timestamp;
+            record.role = static_cast<ConversationLog::Role>(role);
+            record.text.clear();
+            while (length > 0) {
+                if (!fill(1))
+                    return false;
+                size_t chunk = static_cast<size_t>(std::min<uint64_t>(length, m_end - m_pos));
+                record.text.append(m_buffer.data() + m_pos, chunk);
+                consume(chunk);
+                length -= chunk;
+            }
+            return true;
+        }
+    }
+
+    /**
+     * @brief Calls onRecord(const Record&) for every record with
+     * fromMs <= timestamp < toMs; returns how many were visited. Stops at the
+     * first record past the range, as timestamps only grow within a session.
+     */
+    template <typename OnRecord>
+    size_t replay(uint64_t fromMs, uint64_t toMs, OnRecord onRecord) {
+        seek(fromMs);
+        ConversationLog::Record record;
+        size_t count = 0;
+        while (next(record)) {
+            if (record.timestampMs < fromMs)
+                continue;
+            if (record.timestampMs >= toMs)
+                break;
+            onRecord(record);
+            ++count;
+        }
+        return count;
+    }
+
+private:
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+    std::ifstream m_in;
+    uint64_t m_size = 0;
+    std::vector<char> m_buffer = std::vector<char>(BUFFER_SIZE);
+    size_t m_pos = 0;           // Next unread byte in m_buffer
+    size_t m_end = 0;           // End of valid data in m_buffer
+    uint64_t m_offset = 0;      // File offset of m_buffer[m_pos]
+
+    void seekOffset(uint64_t offset) {
+        m_in.clear();
+        m_in.seekg(static_cast<std::streamoff>(offset));
+        m_pos = m_end = 0;
+        m_offset = offset;
+    }
+
+    // Makes at least `count` bytes available unless the file ends first.
+    bool fill(size_t count) {
+        if (m_end - m_pos >= count)
+            return true;
+        std::memmove(m_buffer.data(), m_buffer.data() + m_pos, m_end - m_pos);
+        m_end -= m_pos;
+        m_pos = 0;
+        m_in.read(m_buffer.data() + m_end, static_cast<std::streamsize>(m_buffer.size() - m_end));
+        m_end += static_cast<size_t>(m_in.gcount());
+        return m_end >= count;
+    }
+
+    void consume(size_t count) {
+        m_pos += count;
+        m_offset += count;
+    }
+
+    bool readVarint(uint64_t &value) {
+        value = 0;
+        for (unsigned shift = 0; shift < 64; shift += 7) {
+            if (!fill(1))
+                return false;
+            uint8_t byte = static_cast<uint8_t>(m_buffer[m_pos]);
+            consume(1);
+            value |= static_cast<uint64_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+        throw std::runtime_error("Corrupt varint in conversation log at offset " + std::to_string(m_offset));
+    }
+
+    // Finds the first sync point starting in [from, limit).
+    bool findSync(uint64_t from, uint64_t limit, uint64_t &offset, uint64_t &timestamp) {
+        const auto *marker = ConversationLog::SYNC_MARKER;
+        const size_t markerSize = sizeof(ConversationLog::SYNC_MARKER);
+        seekOffset(from);
+        while (m_offset < limit) {
+            if (!fill(markerSize))
+                return false;
+            auto begin = m_buffer.begin() + static_cast<std::ptrdiff_t>(m_pos);
+            auto end = m_buffer.begin() + static_cast<std::ptrdiff_t>(m_end);
+            auto found = std::search(begin, end, marker, marker + markerSize,
+                                     [](char a, unsigned char b) { return static_cast<unsigned char>(a) == b; });
+            if (found == end) {
+                // Keep a possible partial marker at the end of the buffer.
+                consume(m_end - m_pos - (markerSize - 1));
+                continue;
+            }
+            consume(static_cast<size_t>(found - begin));
+            if (m_offset >= limit)
+                return false;
+            offset = m_offset;
+            consume(markerSize);
+            switch (readSyncPoint(timestamp)) {
+            case SyncPoint::Valid:
+                return true;
+            case SyncPoint::Truncated:
+                return false;
+            case SyncPoint::Coincidental:
+                seekOffset(offset + 1);
+                break;
+            }
+        }
+        return false;
+    }
+
+    enum class SyncPoint { Valid, Truncated, Coincidental };
+
+    // Reads the timestamp after a marker and checks the record that has to
+    // follow it. A file ending before that record is complete still counts as
+    // a sync point.
+    SyncPoint readSyncPoint(uint64_t &timestamp) {
+        try {
+            if (!readVarint(timestamp))
+                return SyncPoint::Truncated;
+            uint64_t recordTimestamp = 0;
+            if (!readVarint(recordTimestamp) || !fill(1))
+                return SyncPoint::Valid;
+            uint8_t role = static_cast<uint8_t>(m_buffer[m_pos]);
+            bool valid = recordTimestamp == timestamp &&
+                         role >= static_cast<uint8_t>(ConversationLog::Role::User) &&
+                         role <= static_cast<uint8_t>(ConversationLog::Role::System);
+            return valid ? SyncPoint::Valid : SyncPoint::Coincidental;
+        } catch (const std::runtime_error &) {
+            return SyncPoint::Coincidental;   // Not a varint
+        }
+    }
+};
+
+#endif // CONVERSATIONLOG_H
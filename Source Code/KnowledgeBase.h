@@ -0,0 +1,2834 @@
+#ifndef KNOWLEDGEBASE_H
+#define KNOWLEDGEBASE_H
+
+// Knowledge base, lookup and import/export machinery shared by the Qt app and
+// the headless batch query tool. Depends only on the standard library.
+
+#include "TokenSignature.h"
+#include "MinHashIndex.h"
+
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <algorithm>
+#include <cctype>
+#include <memory>
+#include <vector>
+#include <random>
+#include <functional>
+#include <cstdint>
+#include <cmath>
+#include <queue>
+#include <string_view>
+#include <cstring>
+#include <stdexcept>
+#include <filesystem>
+#include <future>
+#include <chrono>
+#include <numeric>
+#include <optional>
+#include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+#include <atomic>
+#include <array>
+#include <limits>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// -----------------------------
+// Cryptography Helpers
+// -----------------------------
+class Cryptography {
+public:
+    static constexpr size_t IV_SIZE = 16;
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;   // Chunk size for streaming I/O
+    
+    // The keystream byte i is key[i % |key|] ^ iv[i % |iv|]. It repeats every
+    // lcm(|key|, |iv|) bytes, so one period is computed and copied out into a
+    // tile of up to 4 KiB (just enough for short messages), which is XORed over
+    // the data a machine word at a time, in place.
+    class Keystream {
+    public:
+        Keystream(const std::string &key, const std::string &iv, size_t expectedLength = SIZE_MAX) {
+            size_t period = std::lcm(key.size(), iv.size());
+            size_t span = std::max<size_t>(1, std::min<size_t>(expectedLength, 4096));
+            size_t tile = period * ((span + period - 1) / period);
+            m_pattern.resize(tile);
+            for (size_t i = 0, k = 0, v = 0; i < period; ++i) {
+                m_pattern[i] = key[k] ^ iv[v];
+                k = k + 1 == key.size() ? 0 : k + 1;
+                v = v + 1 == iv.size() ? 0 : v + 1;
+            }
+            for (size_t filled = period; filled < tile; filled *= 2)
+                std::memcpy(m_pattern.data() + filled, m_pattern.data(), std::min(filled, tile - filled));
+        }
+        
+        // Encrypts or decrypts the next `length` bytes of the stream in place.
+        void apply(char *data, size_t length) {
+            while (length > 0) {
+                size_t run = std::min(length, m_pattern.size() - m_offset);
+                xorBytes(data, m_pattern.data() + m_offset, run);
+                data += run;
+                length -= run;
+                m_offset = (m_offset + run) % m_pattern.size();
+            }
+        }
+    
+    private:
+        std::vector<char> m_pattern;
+        size_t m_offset = 0;
+        
+        static void xorBytes(char *data, const char *pattern, size_t length) {
+            size_t i = 0;
+            for (; i + sizeof(uint64_t) <= length; i += sizeof(uint64_t)) {
+                uint64_t word, mask;
+                std::memcpy(&word, data + i, sizeof(word));
+                std::memcpy(&mask, pattern + i, sizeof(mask));
+                word ^= mask;
+                std::memcpy(data + i, &word, sizeof(word));
+            }
+            for (; i < length; ++i)
+                data[i] ^= pattern[i];
+        }
+    };
+    
+    // Incremental decrypt for data that arrives in pieces (files, network
+    // replies). Each piece is decrypted in place and the plaintext part, past
+    // the leading IV, is handed to the sink.
+    class Decryptor {
+    public:
+        explicit Decryptor(const std::string &key) : m_key(key) {}
+        
+        template <typename Sink>
+        void update(char *data, size_t length, Sink &&sink) {
+            if (m_key.empty())
+                return;
+            if (!m_keystream) {
+                size_t take = std::min(length, IV_SIZE - m_iv.size());
+                m_iv.append(data, take);
+                data += take;
+                length -= take;
+                if (m_iv.size() < IV_SIZE)
+                    return;
+                m_keystream.emplace(m_key, m_iv);
+            }
+            if (length == 0)
+                return;
+            m_keystream->apply(data, length);
+            sink(data, length);
+        }
+    
+    private:
+        std::string m_key;
+        std::string m_iv;
+        std::optional<Keystream> m_keystream;
+    };
+    
+    // Incremental encrypt for output produced in pieces. The IV is written ahead
+    // of the first non-empty piece, so empty input leaves the stream empty; each
+    // piece is encrypted in place and written.
+    class Encryptor {
+    public:
+        Encryptor(std::ostream &out, const std::string &key) : m_out(out), m_key(key) {}
+        
+        bool update(char *data, size_t length) {
+            if (length == 0 || m_key.empty())
+                return static_cast<bool>(m_out);
+            if (!m_keystream) {
+                std::string iv = generateRandomIV(IV_SIZE);
+                m_out.write(iv.data(), static_cast<std::streamsize>(iv.size()));
+                m_keystream.emplace(m_key, iv);
+            }
+            m_keystream->apply(data, length);
+            m_out.write(data, static_cast<std::streamsize>(length));
+            return static_cast<bool>(m_out);
+        }
+    
+    private:
+        std::ostream &m_out;
+        std::string m_key;
+        std::optional<Keystream> m_keystream;
+    };
+    
+    static std::string encrypt(const std::string &data, const std::string &key) {
+        if (data.empty() || key.empty()) return "";
+        std::string iv = generateRandomIV(IV_SIZE);
+        std::string result = iv + data;
+        Keystream(key, iv, data.size()).apply(&result[IV_SIZE], data.size());
+        return result;
+    }
+    
+    static std::string decrypt(const std::string &data, const std::string &key) {
+        if (data.empty() || key.empty() || data.size() <= IV_SIZE) return "";
+        std::string result = data.substr(IV_SIZE);
+        Keystream(key, data.substr(0, IV_SIZE), result.size()).apply(&result[0], result.size());
+        return result;
+    }
+    
+    // Writes IV + ciphertext of `data` to `out` block by block, encrypting the
+    // caller's buffer in place instead of building a second copy.
+    static bool encryptTo(std::ostream &out, std::string &data, const std::string &key) {
+        Encryptor encryptor(out, key);
+        for (size_t offset = 0; offset < data.size() && out; offset += BLOCK_SIZE)
+            encryptor.update(&data[offset], std::min(BLOCK_SIZE, data.size() - offset));
+        return static_cast<bool>(out);
+    }
+    
+    // Reads `in` in fixed-size blocks and hands each decrypted block to `sink`.
+    template <typename Sink>
+    static void decryptFrom(std::istream &in, const std::string &key, Sink &&sink) {
+        Decryptor decryptor(key);
+        std::vector<char> block(BLOCK_SIZE);
+        while (in.read(block.data(), static_cast<std::streamsize>(block.size())) || in.gcount() > 0)
+            decryptor.update(block.data(), static_cast<size_t>(in.gcount()), sink);
+    }
+    
+private:
+    static std::string generateRandomIV(size_t length) {
+        // Per thread: journal writes and background compaction both need IVs.
+        static thread_local std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<> dis(0, 255);
+        std::string iv;
+        iv.reserve(length);
+        for (size_t i = 0; i < length; ++i) {
+            iv.push_back(static_cast<char>(dis(gen)));
+        }
+        return iv;
+    }
+};
+
+// -----------------------------
+// Text Processing Helpers
+// -----------------------------
+class TextProcessor {
+public:
+    static std::string normalizeString(const std::string &input) {
+        std::string normalized;
+        normalized.reserve(input.size());
+        normalizeInto(input, normalized);
+        return normalized;
+    }
+    
+    // Appends the normalized form of `input` to `out`, for callers reusing a buffer.
+    static void normalizeInto(std::string_view input, std::string &out) {
+        for (char c : input) {
+            if (!std::ispunct(static_cast<unsigned char>(c))) {
+                out.push_back(std::tolower(static_cast<unsigned char>(c)));
+            }
+        }
+    }
+    
+    static double calculateSimilarity(const std::string &s1, const std::string &s2) {
+        std::vector<std::string> tokens1 = tokenize(s1);
+        std::vector<std::string> tokens2 = tokenize(s2);
+        std::sort(tokens1.begin(), tokens1.end());
+        std::sort(tokens2.begin(), tokens2.end());
+        std::vector<std::string> intersection;
+        std::set_intersection(tokens1.begin(), tokens1.end(),
+                              tokens2.begin(), tokens2.end(),
+                              std::back_inserter(intersection));
+        std::vector<std::string> unionSet;
+        std::set_union(tokens1.begin(), tokens1.end(),
+                       tokens2.begin(), tokens2.end(),
+                       std::back_inserter(unionSet));
+        return unionSet.empty() ? 0.0 : static_cast<double>(intersection.size()) / unionSet.size();
+    }
+    
+    // Same multiset Jaccard as above, over two sorted token-id arrays.
+    static double calculateSimilarity(const uint32_t *ids1, size_t length1,
+                                      const uint32_t *ids2, size_t length2) {
+        size_t i = 0, j = 0, common = 0;
+        while (i < length1 && j < length2) {
+            uint32_t a = ids1[i], b = ids2[j];
+            common += (a == b);
+            i += (a <= b);
+            j += (b <= a);
+        }
+        size_t unionSize = length1 + length2 - common;
+        return unionSize == 0 ? 0.0 : static_cast<double>(common) / unionSize;
+    }
+
+    static std::vector<std::string> tokenize(const std::string &str) {
+        std::vector<std::string> tokens;
+        std::istringstream iss(str);
+        std::string token;
+        while (iss >> token)
+            tokens.push_back(normalizeString(token));
+        return tokens;
+    }
+    
+    // Calls onToken with each whitespace-separated word of `text`, un-normalized
+    // and without copying; the same split as tokenize().
+    template <typename OnToken>
+    static void forEachWord(std::string_view text, OnToken &&onToken) {
+        size_t i = 0;
+        while (i < text.size()) {
+            while (i < text.size() && std::isspace(static_cast<unsigned char>(text[i])))
+                ++i;
+            size_t begin = i;
+            while (i < text.size() && !std::isspace(static_cast<unsigned char>(text[i])))
+                ++i;
+            if (i > begin)
+                onToken(text.substr(begin, i - begin));
+        }
+    }
+};
+
+// -----------------------------
+// Line Splitter
+// -----------------------------
+// Cuts a stream of chunks into lines, holding only the unfinished tail, with
+// the same results as std::getline over the concatenated data.
+class LineSplitter {
+public:
+    template <typename OnLine>
+    void append(const char *data, size_t length, OnLine &&onLine) {
+        const char *end = data + length;
+        while (data < end) {
+            const char *newline = static_cast<const char*>(std::memchr(data, '\n', end - data));
+            if (!newline) {
+                m_pending.append(data, end);
+                return;
+            }
+            if (m_pending.empty()) {
+                onLine(std::string_view(data, newline - data));
+            } else {
+                m_pending.append(data, newline);
+                onLine(std::string_view(m_pending));
+                m_pending.clear();
+            }
+            data = newline + 1;
+        }
+    }
+    
+    template <typename OnLine>
+    void finish(OnLine &&onLine) {
+        if (!m_pending.empty())
+            onLine(std::string_view(m_pending));
+        m_pending.clear();
+    }
+
+private:
+    std::string m_pending;
+};
+
+// -----------------------------
+// Streaming JSON Entry Reader
+// -----------------------------
+// Incremental parser for training files shaped like
+// [{"question": "...", "answer": "..."}, ...]. Input may be split anywhere
+// across chunks and memory use is bounded by the longest single string, not the
+// file size. Other keys, non-object elements and nested values are validated
+// and skipped. Malformed JSON throws std::runtime_error.
+class JsonEntryReader {
+public:
+    // Calls onEntry(question, answer) for every element whose "question" and
+    // "answer" are strings that are non-empty once trimmed. Views are only valid
+    // during the call.
+    template <typename OnEntry>
+    void append(const char *data, size_t length, OnEntry &&onEntry) {
+        const char *begin = data;
+        const char *end = data + length;
+        while (data < end) {
+            switch (m_lexer) {
+            case Lexer::String:
+                data = scanString(data, end);
+                break;
+            case Lexer::Escape:
+                escape(*data++);
+                break;
+            case Lexer::Unicode:
+                unicodeDigit(*data++);
+                break;
+            case Lexer::Literal:
+                if (isLiteralChar(*data)) {
+                    ++data;
+                } else {
+                    m_lexer = Lexer::Between;
+                    afterValue();
+                }
+                break;
+            case Lexer::Between:
+                structural(*data++, onEntry);
+                break;
+            }
+            if (!m_error.empty())
+                throw std::runtime_error("Invalid JSON at byte " +
+                                         std::to_string(m_bytesRead + (data - begin)) + ": " + m_error);
+        }
+        m_bytesRead += length;
+    }
+    
+    void finish() {
+        if (m_lexer == Lexer::Literal) {
+            m_lexer = Lexer::Between;
+            afterValue();
+        }
+        if (m_state == State::Start)
+            throw std::runtime_error("JSON is not in the expected array format");
+        if (m_state != State::Done || m_lexer != Lexer::Between)
+            throw std::runtime_error("Unexpected end of JSON after byte " + std::to_string(m_bytesRead));
+    }
+    
+    // True once the opening '[' of the top-level array has been seen.
+    bool started() const { return m_state != State::Start; }
+    uint64_t bytesRead() const { return m_bytesRead; }
+
+private:
+    enum class Lexer { Between, String, Escape, Unicode, Literal };
+    enum class State { Start, ArrayValueOrEnd, Value, ObjectKeyOrEnd, ObjectKey, Colon, CommaOrEnd, Done };
+    enum class Field { None, Question, Answer };
+    
+    Lexer m_lexer = Lexer::Between;
+    State m_state = State::Start;
+    std::vector<char> m_containers;     // Open '[' and '{', outermost first
+    bool m_inKey = false;               // Current string is an object key
+    std::string *m_stringOut = nullptr; // Decoded string destination, null to discard
+    uint32_t m_unicode = 0;
+    int m_unicodeDigits = 0;
+    uint32_t m_highSurrogate = 0;
+    std::string m_key;                  // Last key seen in the current entry object
+    std::string m_question;
+    std::string m_answer;
+    bool m_hasQuestion = false;
+    bool m_hasAnswer = false;
+    uint64_t m_bytesRead = 0;
+    std::string m_error;
+    
+    static bool isLiteralChar(char c) {
+        return std::isalnum(static_cast<unsigned char>(c)) || c == '-' || c == '+' || c == '.';
+    }
+    
+    // Entry objects are the direct elements of the top-level array.
+    bool atEntryLevel() const { return m_containers.size() == 2 && m_containers[1] == '{'; }
+    
+    Field currentField() const {
+        if (!atEntryLevel())
+            return Field::None;
+        if (m_key == "question")
+            return Field::Question;
+        return m_key == "answer" ? Field::Answer : Field::None;
+    }
+    
+    template <typename OnEntry>
+    void structural(char c, OnEntry &onEntry) {
+        switch (c) {
+        case ' ': case '\t': case '\n': case '\r':
+            return;
+        case '[':
+        case '{':
+            if (m_state == State::Start && c == '[') {
+                m_containers.push_back(c);
+                m_state = State::ArrayValueOrEnd;
+                return;
+            }
+            if (!beginValue())
+                return;
+            if (c == '{' && m_containers.size() == 1) {
+                m_hasQuestion = m_hasAnswer = false;
+                m_key.clear();
+            }
+            m_containers.push_back(c);
+            m_state = c == '[' ? State::ArrayValueOrEnd : State::ObjectKeyOrEnd;
+            return;
+        case ']':
+        case '}': {
+            char open = c == ']' ? '[' : '{';
+            State empty = c == ']' ? State::ArrayValueOrEnd : State::ObjectKeyOrEnd;
+            if (m_containers.empty() || m_containers.back() != open || (m_state != empty && m_state != State::CommaOrEnd)) {
+                m_error = std::string("unexpected '") + c + "'";
+                return;
+            }
+            if (atEntryLevel() && m_hasQuestion && m_hasAnswer)
+                emitEntry(onEntry);
+            m_containers.pop_back();
+            afterValue();
+            return;
+        }
+        case ',':
+            if (m_state != State::CommaOrEnd) {
+                m_error = "unexpected ','";
+                return;
+            }
+            m_state = m_containers.back() == '[' ? State::Value : State::ObjectKey;
+            return;
+        case ':':
+            if (m_state != State::Colon) {
+                m_error = "unexpected ':'";
+                return;
+            }
+            m_state = State::Value;
+            return;
+        case '"':
+            if (m_state == State::ObjectKeyOrEnd || m_state == State::ObjectKey) {
+                m_inKey = true;
+                m_stringOut = atEntryLevel() ? &m_key : nullptr;
+            } else {
+                if (!beginValue())
+                    return;
+                m_inKey = false;
+                Field field = currentField();
+                m_stringOut = field == Field::Question ? &m_question : field == Field::Answer ? &m_answer : nullptr;
+            }
+            if (m_stringOut)
+                m_stringOut->clear();
+            m_lexer = Lexer::String;
+            return;
+        default:
+            if (!isLiteralChar(c)) {
+                m_error = std::string("unexpected character '") + c + "'";
+                return;
+            }
+            if (beginValue())
+                m_lexer = Lexer::Literal;
+            return;
+        }
+    }
+    
+    // A value (of any type) starts here; a non-string value clears the field it replaces.
+    bool beginValue() {
+        if (m_state != State::Value && m_state != State::ArrayValueOrEnd) {
+            m_error = m_state == State::Start ? "not a JSON array" : "unexpected value";
+            return false;
+        }
+        Field field = currentField();
+        if (field == Field::Question)
+            m_hasQuestion = false;
+        else if (field == Field::Answer)
+            m_hasAnswer = false;
+        return true;
+    }
+    
+    void afterValue() {
+        m_state = m_containers.empty() ? State::Done : State::CommaOrEnd;
+    }
+    
+    void endString() {
+        flushSurrogate();
+        m_lexer = Lexer::Between;
+        if (m_inKey) {
+            m_state = State::Colon;
+            return;
+        }
+        if (m_stringOut == &m_question)
+            m_hasQuestion = true;
+        else if (m_stringOut == &m_answer)
+            m_hasAnswer = true;
+        afterValue();
+    }
+    
+    const char *scanString(const char *data, const char *end) {
+        const char *run = data;
+        while (data < end) {
+            char c = *data;
+            if (c == '"' || c == '\\' || static_cast<unsigned char>(c) < 0x20)
+                break;
+            ++data;
+        }
+        if (data > run) {
+            flushSurrogate();
+            if (m_stringOut)
+                m_stringOut->append(run, data);
+        }
+        if (data == end)
+            return data;
+        char c = *data++;
+        if (c == '"')
+            endString();
+        else if (c == '\\')
+            m_lexer = Lexer::Escape;
+        else
+            m_error = "control character in string";
+        return data;
+    }
+    
+    void escape(char c) {
+        static const char from[] = "\"\\/bfnrt";
+        static const char to[] = "\"\\/\b\f\n\r\t";
+        m_lexer = Lexer::String;
+        if (c == 'u') {
+            m_lexer = Lexer::Unicode;
+            m_unicode = 0;
+            m_unicodeDigits = 0;
+            return;
+        }
+        const char *found = std::strchr(from, c);
+        if (!found || c == '\0') {
+            m_error = "invalid escape";
+            return;
+        }
+        flushSurrogate();
+        if (m_stringOut)
+            m_stringOut->push_back(to[found - from]);
+    }
+    
+    void unicodeDigit(char c) {
+        int digit = std::isdigit(static_cast<unsigned char>(c)) ? c - '0'
+                  : (c >= 'a' && c <= 'f') ? c - 'a' + 10
+                  : (c >= 'A' && c <= 'F') ? c - 'A' + 10 : -1;
+        if (digit < 0) {
+            m_error = "invalid \\u escape";
+            return;
+        }
+        m_unicode = (m_unicode << 4) | static_cast<uint32_t>(digit);
+        if (++m_unicodeDigits < 4)
+            return;
+        m_lexer = Lexer::String;
+        if (m_unicode >= 0xDC00 && m_unicode < 0xE000 && m_highSurrogate) {
+            appendUtf8(0x10000 + ((m_highSurrogate - 0xD800) << 10) + (m_unicode - 0xDC00));
+            m_highSurrogate = 0;
+            return;
+        }
+        flushSurrogate();
+        if (m_unicode >= 0xD800 && m_unicode < 0xDC00)
+            m_highSurrogate = m_unicode;
+        else
+            appendUtf8(m_unicode >= 0xDC00 && m_unicode < 0xE000 ? 0xFFFD : m_unicode);
+    }
+    
+    // A high surrogate not followed by a low one decodes to U+FFFD.
+    void flushSurrogate() {
+        if (m_highSurrogate) {
+            m_highSurrogate = 0;
+            appendUtf8(0xFFFD);
+        }
+    }
+    
+    void appendUtf8(uint32_t codePoint) {
+        if (!m_stringOut)
+            return;
+        std::string &out = *m_stringOut;
+        if (codePoint < 0x80) {
+            out.push_back(static_cast<char>(codePoint));
+        } else if (codePoint < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        } else if (codePoint < 0x10000) {
+            out.push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+    
+    static std::string_view trimmed(std::string_view text) {
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front())))
+            text.remove_prefix(1);
+        while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back())))
+            text.remove_suffix(1);
+        return text;
+    }
+    
+    template <typename OnEntry>
+    void emitEntry(OnEntry &onEntry) {
+        std::string_view question = trimmed(m_question);
+        std::string_view answer = trimmed(m_answer);
+        if (!question.empty() && !answer.empty())
+            onEntry(question, answer);
+    }
+};
+
+// -----------------------------
+// Streaming JSON Entry Writer
+// -----------------------------
+// Serializes question/answer pairs one at a time into a fixed-size buffer that
+// is handed to `sink` whenever it fills, so an export never holds more than one
+// buffer of output. Indented follows the layout of QJsonDocument::toJson(Indented)
+// (4-space indent, keys sorted); Compact drops the whitespace and Lines writes
+// one object per line (JSON Lines).
+class JsonEntryWriter {
+public:
+    enum class Layout { Indented, Compact, Lines };
+    using Sink = std::function<void(const char *data, size_t length)>;
+    
+    static constexpr size_t BUFFER_SIZE = 64 * 1024;
+    
+    JsonEntryWriter(Layout layout, Sink sink) : m_layout(layout), m_sink(std::move(sink)) {
+        m_buffer.reserve(BUFFER_SIZE + 1024);
+        if (m_layout != Layout::Lines)
+            m_buffer += '[';
+    }
+    
+    void write(std::string_view question, std::string_view answer) {
+        switch (m_layout) {
+        case Layout::Indented:
+            m_buffer += m_count == 0 ? "\n    {\n        \"answer\": " : ",\n    {\n        \"answer\": ";
+            appendString(answer);
+            m_buffer += ",\n        \"question\": ";
+            appendString(question);
+            m_buffer += "\n    }";
+            break;
+        case Layout::Compact:
+            m_buffer += m_count == 0 ? "{\"answer\":" : ",{\"answer\":";
+            appendString(answer);
+            m_buffer += ",\"question\":";
+            appendString(question);
+            m_buffer += '}';
+            break;
+        case Layout::Lines:
+            m_buffer += "{\"answer\":";
+            appendString(answer);
+            m_buffer += ",\"question\":";
+            appendString(question);
+            m_buffer += "}\n";
+            break;
+        }
+        ++m_count;
+        if (m_buffer.size() >= BUFFER_SIZE)
+            flush();
+    }
+    
+    // Closes the array and hands the remaining output to the sink.
+    void finish() {
+        if (m_layout == Layout::Indented)
+            m_buffer += "\n]\n";
+        else if (m_layout == Layout::Compact)
+            m_buffer += ']';
+        flush();
+    }
+    
+    size_t count() const { return m_count; }
+
+private:
+    Layout m_layout;
+    Sink m_sink;
+    std::string m_buffer;
+    size_t m_count = 0;
+    
+    void flush() {
+        if (!m_buffer.empty())
+            m_sink(m_buffer.data(), m_buffer.size());
+        m_buffer.clear();
+    }
+    
+    void appendString(std::string_view text) {
+        static const char hex[] = "0123456789abcdef";
+        m_buffer += '"';
+        size_t run = 0;
+        for (size_t i = 0; i < text.size(); ++i) {
+            unsigned char c = static_cast<unsigned char>(text[i]);
+            if (c >= 0x20 && c != '"' && c != '\\')
+                continue;
+            m_buffer.append(text.data() + run, i - run);
+            run = i + 1;
+            m_buffer += '\\';
+            switch (c) {
+            case '"': m_buffer += '"'; break;
+            case '\\': m_buffer += '\\'; break;
+            case '\b': m_buffer += 'b'; break;
+            case '\f': m_buffer += 'f'; break;
+            case '\n': m_buffer += 'n'; break;
+            case '\r': m_buffer += 'r'; break;
+            case '\t': m_buffer += 't'; break;
+            default:
+                m_buffer += "u00";
+                m_buffer += hex[c >> 4];
+                m_buffer += hex[c & 0xF];
+                break;
+            }
+        }
+        m_buffer.append(text.data() + run, text.size() - run);
+        m_buffer += '"';
+    }
+};
+
+// -----------------------------
+// Token Index
+// -----------------------------
+// Reserves room for `size` elements, at least doubling the capacity so repeated
+// per-batch reservations keep appends amortized O(1).
+template <typename Container>
+inline void reserveGrowth(Container &container, size_t size) {
+    if (size > container.capacity())
+        container.reserve(std::max<size_t>(size, container.capacity() * 2));
+}
+
+// Interns tokens as 32-bit ids, stores each entry's question once as a sorted
+// id array, and keeps an inverted index from token id to the entries containing
+// it, so fuzzy matching only scores entries that can still reach the threshold.
+class TokenIndex {
+public:
+    static constexpr uint32_t UNKNOWN_TOKEN = UINT32_MAX;
+    
+    // Tokenizes `text` like TextProcessor::tokenize, appends it as an entry and
+    // returns its id; ids are assigned sequentially.
+    uint32_t addEntry(std::string_view text) {
+        uint32_t entryId = static_cast<uint32_t>(m_entryOffsets.size() - 1);
+        size_t begin = m_entryTokens.size();
+        TextProcessor::forEachWord(text, [this](std::string_view word) {
+            m_tokenScratch.clear();
+            TextProcessor::normalizeInto(word, m_tokenScratch);
+            auto it = m_tokenIds.find(m_tokenScratch);
+            if (it == m_tokenIds.end()) {
+                it = m_tokenIds.emplace(m_tokenScratch, static_cast<uint32_t>(m_postings.size())).first;
+                m_postings.emplace_back();
+            }
+            m_entryTokens.push_back(it->second);
+        });
+        std::sort(m_entryTokens.begin() + begin, m_entryTokens.end());
+        m_entryOffsets.push_back(static_cast<uint32_t>(m_entryTokens.size()));
+        TokenSignature signature;
+        for (size_t i = begin; i < m_entryTokens.size(); ++i) {
+            signature.add(m_entryTokens[i]);
+            if (i == begin || m_entryTokens[i] != m_entryTokens[i - 1])
+                m_postings[m_entryTokens[i]].push_back(entryId);
+        }
+        m_signatures.push_back(signature);
+        return entryId;
+    }
+    
+    // Maps query tokens to a sorted id array. Tokens never seen at insert time
+    // become UNKNOWN_TOKEN, which counts towards the union but matches nothing.
+    std::vector<uint32_t> encodeQuery(const std::vector<std::string> &tokens) const {
+        std::vector<uint32_t> ids;
+        ids.reserve(tokens.size());
+        for (const auto &token : tokens) {
+            auto it = m_tokenIds.find(token);
+            ids.push_back(it == m_tokenIds.end() ? UNKNOWN_TOKEN : it->second);
+        }
+        std::sort(ids.begin(), ids.end());
+        return ids;
+    }
+    
+    static TokenSignature signature(const std::vector<uint32_t> &query) {
+        TokenSignature result;
+        for (uint32_t tokenId : query)
+            result.add(tokenId);
+        return result;
+    }
+    
+    // Cheap bit-signature bound; entries at or below the threshold here can be
+    // skipped without exact scoring.
+    double similarityUpperBound(const TokenSignature &querySignature, size_t queryLength, uint32_t entryId) const {
+        return SignatureKernels::jaccardUpperBound(querySignature, queryLength,
+                                                   m_signatures[entryId], entryLength(entryId));
+    }
+    
+    double similarity(const std::vector<uint32_t> &query, uint32_t entryId) const {
+        return TextProcessor::calculateSimilarity(query.data(), query.size(),
+                                                  entryTokens(entryId), entryLength(entryId));
+    }
+    
+    // Returns, in ascending id order, every entry whose Jaccard similarity with
+    // the encoded query could exceed the threshold.
+    std::vector<uint32_t> candidates(const std::vector<uint32_t> &query, double threshold) const {
+        return collectCandidates(query, threshold,
+            [this](uint32_t tokenId) {
+                const std::vector<uint32_t> &postings = m_postings[tokenId];
+                return std::make_pair(postings.data(), postings.size());
+            },
+            [this](uint32_t entryId) { return entryLength(entryId); });
+    }
+    
+    // Prefix and size filtering shared by every index layout. `postings(tokenId)`
+    // yields (ascending ids, count) and `entryLength(entryId)` the entry's token count.
+    template <typename PostingsFn, typename LengthFn>
+    static std::vector<uint32_t> collectCandidates(const std::vector<uint32_t> &query, double threshold,
+                                                   PostingsFn postings, LengthFn entryLength) {
+        std::vector<uint32_t> result;
+        const size_t queryLength = query.size();
+        if (queryLength == 0)
+            return result;
+        
+        // A match shares more than threshold * |query| tokens with the query, so it
+        // must contain one of any (|query| - minOverlap + 1) query tokens. Probe the
+        // shortest posting lists until that many tokens are covered.
+        size_t minOverlap = static_cast<size_t>(std::floor(threshold * queryLength - 1e-9)) + 1;
+        minOverlap = std::max<size_t>(1, std::min(minOverlap, queryLength));
+        const size_t prefixLength = queryLength - minOverlap + 1;
+        
+        struct Probe {
+            const uint32_t *ids;
+            size_t count;
+            size_t multiplicity;
+        };
+        std::vector<Probe> probes;
+        for (size_t i = 0; i < queryLength;) {
+            size_t j = i;
+            while (j < queryLength && query[j] == query[i])
+                ++j;
+            if (query[i] == UNKNOWN_TOKEN) {
+                probes.push_back({nullptr, 0, j - i});
+            } else {
+                auto list = postings(query[i]);
+                probes.push_back({list.first, list.second, j - i});
+            }
+            i = j;
+        }
+        std::sort(probes.begin(), probes.end(), [](const Probe &a, const Probe &b) {
+            return a.count < b.count;
+        });
+        size_t covered = 0;
+        for (const auto &probe : probes) {
+            if (covered >= prefixLength)
+                break;
+            covered += probe.multiplicity;
+            result.insert(result.end(), probe.ids, probe.ids + probe.count);
+        }
+        std::sort(result.begin(), result.end());
+        result.erase(std::unique(result.begin(), result.end()), result.end());
+        
+        // Size filter: Jaccard never exceeds min(|a|, |b|) / max(|a|, |b|).
+        result.erase(std::remove_if(result.begin(), result.end(), [&](uint32_t entryId) {
+            double length = static_cast<double>(entryLength(entryId));
+            double shorter = std::min<double>(queryLength, length);
+            double longer = std::max<double>(queryLength, length);
+            return shorter / longer <= threshold;
+        }), result.end());
+        return result;
+    }
+    
+    const uint32_t *entryTokens(uint32_t entryId) const {
+        return m_entryTokens.data() + m_entryOffsets[entryId];
+    }
+    
+    size_t entryLength(uint32_t entryId) const {
+        return m_entryOffsets[entryId + 1] - m_entryOffsets[entryId];
+    }
+    
+    // Pre-sizes the per-entry arrays for `entries` more entries of about
+    // `tokens` tokens in total.
+    void reserve(size_t entries, size_t tokens) {
+        reserveGrowth(m_entryTokens, m_entryTokens.size() + tokens);
+        reserveGrowth(m_entryOffsets, m_entryOffsets.size() + entries);
+        reserveGrowth(m_signatures, m_signatures.size() + entries);
+    }
+    
+    void clear() {
+        m_tokenIds.clear();
+        m_postings.clear();
+        m_entryTokens.clear();
+        m_entryOffsets.assign(1, 0);
+        m_signatures.clear();
+    }
+
+private:
+    std::unordered_map<std::string, uint32_t> m_tokenIds;
+    std::vector<std::vector<uint32_t>> m_postings;   // Token id -> ascending entry ids
+    std::vector<uint32_t> m_entryTokens;             // Sorted token ids of every entry, back to back
+    std::vector<uint32_t> m_entryOffsets{0};         // Entry id -> start in m_entryTokens
+    std::vector<TokenSignature> m_signatures;        // Entry id -> bit signature of its tokens
+    std::string m_tokenScratch;                      // Reused lookup key for addEntry
+};
+
+// -----------------------------
+// Ranked Matches
+// -----------------------------
+struct AnswerMatch {
+    std::string answer;
+    double score;        // 1.0 for an exact hit, otherwise Jaccard similarity
+    uint32_t entryId;
+};
+
+// Keeps the k best (score, entry id) pairs above a threshold in a bounded
+// min-heap. Entries must be offered in ascending id order, so a newcomer only
+// displaces the current worst on a strictly higher score and ties stay oldest first.
+class TopKCollector {
+public:
+    using Scored = std::pair<double, uint32_t>;
+    
+    TopKCollector(size_t k, double threshold) : m_k(k), m_threshold(threshold) {}
+    
+    // Score a candidate has to beat to be kept.
+    double minScore() const {
+        return m_heap.size() < m_k ? m_threshold : std::max(m_threshold, m_heap.top().first);
+    }
+    
+    void offer(double score, uint32_t entryId) {
+        if (m_k == 0 || score <= minScore())
+            return;
+        if (m_heap.size() == m_k)
+            m_heap.pop();
+        m_heap.emplace(score, entryId);
+    }
+    
+    // Drains the collector, best first.
+    std::vector<Scored> takeSorted() {
+        std::vector<Scored> result(m_heap.size());
+        for (size_t i = result.size(); i > 0; --i) {
+            result[i - 1] = m_heap.top();
+            m_heap.pop();
+        }
+        return result;
+    }
+
+private:
+    struct Worse {
+        bool operator()(const Scored &a, const Scored &b) const {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        }
+    };
+    size_t m_k;
+    double m_threshold;
+    std::priority_queue<Scored, std::vector<Scored>, Worse> m_heap;   // Worst match on top
+};
+
+// -----------------------------
+// Parallel Scan Pool
+// -----------------------------
+// Fork-join pool for splitting one scan into shards. run() hands shard indices
+// out to the workers and the calling thread, and returns once every shard is
+// done. Concurrent run() calls are served one at a time.
+class ScanPool {
+public:
+    explicit ScanPool(size_t threads) {
+        for (size_t i = 1; i < std::max<size_t>(threads, 1); ++i)
+            m_workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~ScanPool() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_start.notify_all();
+        for (auto &worker : m_workers)
+            worker.join();
+    }
+
+    ScanPool(const ScanPool &) = delete;
+    ScanPool &operator=(const ScanPool &) = delete;
+
+    // Threads that take part in run(), the caller included.
+    size_t threadCount() const { return m_workers.size() + 1; }
+
+    void run(size_t shards, const std::function<void(size_t shard)> &task) {
+        std::lock_guard<std::mutex> runLock(m_runMutex);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_task = &task;
+            m_shards = shards;
+            m_nextShard = 0;
+            m_busyWorkers = m_workers.size();
+            ++m_generation;
+        }
+        m_start.notify_all();
+        runShards();
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_done.wait(lock, [this] { return m_busyWorkers == 0; });
+        m_task = nullptr;
+    }
+
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_runMutex;
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    const std::function<void(size_t)> *m_task = nullptr;
+    size_t m_shards = 0;
+    std::atomic<size_t> m_nextShard{0};
+    size_t m_busyWorkers = 0;
+    uint64_t m_generation = 0;
+    bool m_stopping = false;
+
+    void runShards() {
+        for (size_t shard = m_nextShard++; shard < m_shards; shard = m_nextShard++)
+            (*m_task)(shard);
+    }
+
+    void workerLoop() {
+        uint64_t seenGeneration = 0;
+        for (;;) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_start.wait(lock, [&] { return m_stopping || m_generation != seenGeneration; });
+                if (m_stopping)
+                    return;
+                seenGeneration = m_generation;
+            }
+            runShards();
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                --m_busyWorkers;
+            }
+            m_done.notify_one();
+        }
+    }
+};
+
+// -----------------------------
+// Mapped Knowledge Base Snapshot
+// -----------------------------
+// Versioned, read-only on-disk layout that is mmap'ed and queried in place:
+//
+//   Header | entry records | entry hash | token records | token hash |
+//   postings | entry token ids | string table
+//
+// All integers are little-endian and every section starts 8-byte aligned.
+// Offsets are from the start of the file. The snapshot is stored in clear,
+// unlike the encrypted .dat file, so it is meant for read-only deployments.
+namespace SnapshotFormat {
+    constexpr char MAGIC[8] = {'N', 'X', 'K', 'B', 'S', 'N', 'A', 'P'};
+    constexpr uint32_t VERSION = 1;
+    constexpr uint32_t EMPTY_BUCKET = UINT32_MAX;
+    
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t entryCount;
+        uint32_t tokenCount;
+        uint32_t entryBuckets;        // Power of two
+        uint32_t tokenBuckets;        // Power of two
+        uint32_t postingCount;
+        uint32_t entryTokenCount;
+        uint32_t reserved[3];
+        uint64_t entriesOffset;
+        uint64_t entryHashOffset;
+        uint64_t tokensOffset;
+        uint64_t tokenHashOffset;
+        uint64_t postingsOffset;
+        uint64_t entryTokensOffset;
+        uint64_t stringsOffset;
+        uint64_t stringsSize;
+    };
+    
+    struct EntryRecord {
+        uint64_t questionOffset;      // Into the string table
+        uint64_t answerOffset;
+        uint32_t questionLength;
+        uint32_t answerLength;
+        uint32_t tokensOffset;        // Into the entry token ids, sorted
+        uint32_t tokensLength;
+    };
+    
+    struct TokenRecord {
+        uint64_t textOffset;
+        uint32_t textLength;
+        uint32_t postingsOffset;      // Into the postings, ascending entry ids
+        uint32_t postingsLength;
+        uint32_t reserved;
+    };
+    
+    static_assert(sizeof(Header) == 112, "snapshot header layout changed");
+    static_assert(sizeof(EntryRecord) == 32, "snapshot entry layout changed");
+    static_assert(sizeof(TokenRecord) == 24, "snapshot token layout changed");
+    
+    inline uint64_t hash(std::string_view text) {
+        uint64_t h = 0xcbf29ce484222325ULL;   // FNV-1a
+        for (unsigned char c : text) {
+            h ^= c;
+            h *= 0x100000001b3ULL;
+        }
+        return h;
+    }
+    
+    inline uint32_t bucketCountFor(size_t items) {
+        uint32_t buckets = 16;
+        while (buckets < items * 2)
+            buckets <<= 1;
+        return buckets;
+    }
+}
+
+struct MappedMatch {
+    std::string_view answer;   // Points into the mapping; valid while the snapshot lives
+    double score;
+    uint32_t entryId;
+};
+
+class MappedKnowledgeBase {
+public:
+    // Maps the snapshot and checks its header. Entries are not touched, so
+    // opening costs the same regardless of knowledge-base size; ids and offsets
+    // read from the sections are checked on access instead, and a corrupt
+    // record reads as a miss.
+    explicit MappedKnowledgeBase(const std::string &filename) {
+        map(filename);
+        if (m_size < sizeof(SnapshotFormat::Header)) {
+            unmap();
+            throw std::runtime_error("Snapshot too small: " + filename);
+        }
+        m_header = reinterpret_cast<const SnapshotFormat::Header*>(m_base);
+        if (std::memcmp(m_header->magic, SnapshotFormat::MAGIC, sizeof(SnapshotFormat::MAGIC)) != 0 ||
+            m_header->version != SnapshotFormat::VERSION || !sectionsFit()) {
+            unmap();
+            throw std::runtime_error("Not a valid knowledge-base snapshot: " + filename);
+        }
+        m_entries = section<SnapshotFormat::EntryRecord>(m_header->entriesOffset);
+        m_entryHash = section<uint32_t>(m_header->entryHashOffset);
+        m_tokens = section<SnapshotFormat::TokenRecord>(m_header->tokensOffset);
+        m_tokenHash = section<uint32_t>(m_header->tokenHashOffset);
+        m_postings = section<uint32_t>(m_header->postingsOffset);
+        m_entryTokens = section<uint32_t>(m_header->entryTokensOffset);
+        m_strings = m_base + m_header->stringsOffset;
+    }
+    
+    ~MappedKnowledgeBase() {
+        unmap();
+    }
+    
+    MappedKnowledgeBase(const MappedKnowledgeBase&) = delete;
+    MappedKnowledgeBase& operator=(const MappedKnowledgeBase&) = delete;
+    
+    // Writes (question, answer) pairs, in entry-id order, as a snapshot file.
+    // Questions are expected to be normalized and unique.
+    static void write(const std::string &filename,
+                      const std::vector<std::pair<std::string_view, std::string_view>> &entries) {
+        using namespace SnapshotFormat;
+        std::string strings;
+        std::vector<EntryRecord> entryRecords;
+        std::vector<uint32_t> entryTokens;
+        std::unordered_map<std::string, uint32_t> tokenIds;
+        std::vector<std::string> tokenTexts;
+        std::vector<std::vector<uint32_t>> tokenPostings;
+        entryRecords.reserve(entries.size());
+        
+        for (uint32_t entryId = 0; entryId < entries.size(); ++entryId) {
+            const auto &entry = entries[entryId];
+            EntryRecord record{};
+            record.questionOffset = strings.size();
+            record.questionLength = static_cast<uint32_t>(entry.first.size());
+            strings.append(entry.first);
+            record.answerOffset = strings.size();
+            record.answerLength = static_cast<uint32_t>(entry.second.size());
+            strings.append(entry.second);
+            record.tokensOffset = static_cast<uint32_t>(entryTokens.size());
+            for (const auto &token : TextProcessor::tokenize(std::string(entry.first))) {
+                auto result = tokenIds.emplace(token, static_cast<uint32_t>(tokenTexts.size()));
+                if (result.second) {
+                    tokenTexts.push_back(token);
+                    tokenPostings.emplace_back();
+                }
+                entryTokens.push_back(result.first->second);
+            }
+            std::sort(entryTokens.begin() + record.tokensOffset, entryTokens.end());
+            record.tokensLength = static_cast<uint32_t>(entryTokens.size() - record.tokensOffset);
+            for (size_t i = record.tokensOffset; i < entryTokens.size(); ++i) {
+                if (i == record.tokensOffset || entryTokens[i] != entryTokens[i - 1])
+                    tokenPostings[entryTokens[i]].push_back(entryId);
+            }
+            entryRecords.push_back(record);
+        }
+        
+        Header header{};
+        std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+        header.version = VERSION;
+        header.entryCount = static_cast<uint32_t>(entries.size());
+        header.tokenCount = static_cast<uint32_t>(tokenTexts.size());
+        header.entryBuckets = bucketCountFor(entries.size());
+        header.tokenBuckets = bucketCountFor(tokenTexts.size());
+        
+        std::vector<uint32_t> entryHash(header.entryBuckets, EMPTY_BUCKET);
+        for (uint32_t entryId = 0; entryId < entries.size(); ++entryId) {
+            uint32_t bucket = static_cast<uint32_t>(hash(entries[entryId].first)) & (header.entryBuckets - 1);
+            while (entryHash[bucket] != EMPTY_BUCKET)
+                bucket = (bucket + 1) & (header.entryBuckets - 1);
+            entryHash[bucket] = entryId;
+        }
+        
+        std::vector<TokenRecord> tokenRecords(tokenTexts.size());
+        std::vector<uint32_t> postings;
+        std::vector<uint32_t> tokenHash(header.tokenBuckets, EMPTY_BUCKET);
+        for (uint32_t tokenId = 0; tokenId < tokenTexts.size(); ++tokenId) {
+            TokenRecord &record = tokenRecords[tokenId];
+            record.textOffset = strings.size();
+            record.textLength = static_cast<uint32_t>(tokenTexts[tokenId].size());
+            strings.append(tokenTexts[tokenId]);
+            record.postingsOffset = static_cast<uint32_t>(postings.size());
+            record.postingsLength = static_cast<uint32_t>(tokenPostings[tokenId].size());
+            postings.insert(postings.end(), tokenPostings[tokenId].begin(), tokenPostings[tokenId].end());
+            uint32_t bucket = static_cast<uint32_t>(hash(tokenTexts[tokenId])) & (header.tokenBuckets - 1);
+            while (tokenHash[bucket] != EMPTY_BUCKET)
+                bucket = (bucket + 1) & (header.tokenBuckets - 1);
+            tokenHash[bucket] = tokenId;
+        }
+        header.postingCount = static_cast<uint32_t>(postings.size());
+        header.entryTokenCount = static_cast<uint32_t>(entryTokens.size());
+        
+        uint64_t offset = sizeof(Header);
+        auto place = [&offset](uint64_t bytes) {
+            uint64_t start = offset;
+            offset = (offset + bytes + 7) & ~uint64_t(7);
+            return start;
+        };
+        header.entriesOffset = place(entryRecords.size() * sizeof(EntryRecord));
+        header.entryHashOffset = place(entryHash.size() * sizeof(uint32_t));
+        header.tokensOffset = place(tokenRecords.size() * sizeof(TokenRecord));
+        header.tokenHashOffset = place(tokenHash.size() * sizeof(uint32_t));
+        header.postingsOffset = place(postings.size() * sizeof(uint32_t));
+        header.entryTokensOffset = place(entryTokens.size() * sizeof(uint32_t));
+        header.stringsOffset = place(strings.size());
+        header.stringsSize = strings.size();
+        
+        std::ofstream outFile(filename, std::ios::binary | std::ios::trunc);
+        if (!outFile)
+            throw std::runtime_error("Unable to write snapshot: " + filename);
+        uint64_t written = 0;
+        auto emit = [&](uint64_t at, const void *data, size_t bytes) {
+            static const char padding[8] = {};
+            outFile.write(padding, static_cast<std::streamsize>(at - written));
+            outFile.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+            written = at + bytes;
+        };
+        emit(0, &header, sizeof(header));
+        emit(header.entriesOffset, entryRecords.data(), entryRecords.size() * sizeof(EntryRecord));
+        emit(header.entryHashOffset, entryHash.data(), entryHash.size() * sizeof(uint32_t));
+        emit(header.tokensOffset, tokenRecords.data(), tokenRecords.size() * sizeof(TokenRecord));
+        emit(header.tokenHashOffset, tokenHash.data(), tokenHash.size() * sizeof(uint32_t));
+        emit(header.postingsOffset, postings.data(), postings.size() * sizeof(uint32_t));
+        emit(header.entryTokensOffset, entryTokens.data(), entryTokens.size() * sizeof(uint32_t));
+        emit(header.stringsOffset, strings.data(), strings.size());
+        if (!outFile)
+            throw std::runtime_error("Unable to write snapshot: " + filename);
+    }
+    
+    std::string_view findAnswer(const std::string &question) const {
+        std::vector<MappedMatch> matches = findTopK(question, 1);
+        return matches.empty() ? std::string_view() : matches.front().answer;
+    }
+    
+    // Same ranking as KnowledgeBase::findTopK, answered straight from the mapping.
+    std::vector<MappedMatch> findTopK(const std::string &question, size_t k) const {
+        std::vector<MappedMatch> matches;
+        if (k == 0)
+            return matches;
+        std::string normalizedQuestion = TextProcessor::normalizeString(question);
+        uint32_t exactId = findEntry(normalizedQuestion);
+        if (exactId != SnapshotFormat::EMPTY_BUCKET) {
+            matches.push_back({answer(exactId), 1.0, exactId});
+            if (k == 1)
+                return matches;
+            --k;
+        }
+        const double SIMILARITY_THRESHOLD = 0.8;
+        std::vector<uint32_t> query;
+        for (const auto &token : TextProcessor::tokenize(normalizedQuestion))
+            query.push_back(findToken(token));
+        std::sort(query.begin(), query.end());
+        std::vector<uint32_t> candidates = TokenIndex::collectCandidates(query, SIMILARITY_THRESHOLD,
+            [this](uint32_t tokenId) { return postings(tokenId); },
+            [this](uint32_t entryId) { return entryTokens(entryId).second; });
+        
+        TopKCollector best(k, SIMILARITY_THRESHOLD);
+        for (uint32_t entryId : candidates) {
+            if (entryId == exactId)
+                continue;
+            auto tokens = entryTokens(entryId);
+            best.offer(TextProcessor::calculateSimilarity(query.data(), query.size(), tokens.first, tokens.second),
+                       entryId);
+        }
+        for (const auto &scored : best.takeSorted())
+            matches.push_back({answer(scored.second), scored.first, scored.second});
+        return matches;
+    }
+    
+    std::string_view question(uint32_t entryId) const {
+        if (entryId >= m_header->entryCount)
+            return std::string_view();
+        const SnapshotFormat::EntryRecord &record = m_entries[entryId];
+        return text(record.questionOffset, record.questionLength);
+    }
+    
+    std::string_view answer(uint32_t entryId) const {
+        if (entryId >= m_header->entryCount)
+            return std::string_view();
+        const SnapshotFormat::EntryRecord &record = m_entries[entryId];
+        return text(record.answerOffset, record.answerLength);
+    }
+    
+    size_t size() const {
+        return m_header->entryCount;
+    }
+
+private:
+    const char *m_base = nullptr;
+    size_t m_size = 0;
+#ifdef _WIN32
+    HANDLE m_file = INVALID_HANDLE_VALUE;
+    HANDLE m_mapping = nullptr;
+#endif
+    const SnapshotFormat::Header *m_header = nullptr;
+    const SnapshotFormat::EntryRecord *m_entries = nullptr;
+    const uint32_t *m_entryHash = nullptr;
+    const SnapshotFormat::TokenRecord *m_tokens = nullptr;
+    const uint32_t *m_tokenHash = nullptr;
+    const uint32_t *m_postings = nullptr;
+    const uint32_t *m_entryTokens = nullptr;
+    const char *m_strings = nullptr;
+    
+    template <typename T>
+    const T *section(uint64_t offset) const {
+        return reinterpret_cast<const T*>(m_base + offset);
+    }
+    
+    // Bounds-checked view into the string table; a corrupt record yields "".
+    std::string_view text(uint64_t offset, uint32_t length) const {
+        if (offset > m_header->stringsSize || length > m_header->stringsSize - offset)
+            return std::string_view();
+        return std::string_view(m_strings + offset, length);
+    }
+    
+    // Bounds-checked slices of the postings and entry token sections; a corrupt
+    // record yields an empty list.
+    static bool spans(uint32_t offset, uint32_t length, uint32_t count) {
+        return offset <= count && length <= count - offset;
+    }
+    
+    std::pair<const uint32_t*, size_t> postings(uint32_t tokenId) const {
+        if (tokenId >= m_header->tokenCount)
+            return {nullptr, 0};
+        const SnapshotFormat::TokenRecord &record = m_tokens[tokenId];
+        if (!spans(record.postingsOffset, record.postingsLength, m_header->postingCount))
+            return {nullptr, 0};
+        return {m_postings + record.postingsOffset, record.postingsLength};
+    }
+    
+    std::pair<const uint32_t*, size_t> entryTokens(uint32_t entryId) const {
+        if (entryId >= m_header->entryCount)
+            return {nullptr, 0};
+        const SnapshotFormat::EntryRecord &record = m_entries[entryId];
+        if (!spans(record.tokensOffset, record.tokensLength, m_header->entryTokenCount))
+            return {nullptr, 0};
+        return {m_entryTokens + record.tokensOffset, record.tokensLength};
+    }
+    
+    // Linear probing, bounded by the bucket count so a table without an empty
+    // bucket cannot loop forever. Out-of-range ids end the probe as a miss.
+    uint32_t findEntry(std::string_view normalizedQuestion) const {
+        const uint32_t mask = m_header->entryBuckets - 1;
+        uint32_t bucket = static_cast<uint32_t>(SnapshotFormat::hash(normalizedQuestion)) & mask;
+        for (uint32_t probe = 0; probe < m_header->entryBuckets; ++probe, bucket = (bucket + 1) & mask) {
+            uint32_t entryId = m_entryHash[bucket];
+            if (entryId >= m_header->entryCount)
+                return SnapshotFormat::EMPTY_BUCKET;
+            if (question(entryId) == normalizedQuestion)
+                return entryId;
+        }
+        return SnapshotFormat::EMPTY_BUCKET;
+    }
+    
+    uint32_t findToken(std::string_view token) const {
+        const uint32_t mask = m_header->tokenBuckets - 1;
+        uint32_t bucket = static_cast<uint32_t>(SnapshotFormat::hash(token)) & mask;
+        for (uint32_t probe = 0; probe < m_header->tokenBuckets; ++probe, bucket = (bucket + 1) & mask) {
+            uint32_t tokenId = m_tokenHash[bucket];
+            if (tokenId >= m_header->tokenCount)
+                return TokenIndex::UNKNOWN_TOKEN;
+            const SnapshotFormat::TokenRecord &record = m_tokens[tokenId];
+            if (text(record.textOffset, record.textLength) == token)
+                return tokenId;
+        }
+        return TokenIndex::UNKNOWN_TOKEN;
+    }
+    
+    bool sectionsFit() const {
+        const SnapshotFormat::Header &h = *m_header;
+        auto fits = [this](uint64_t offset, uint64_t count, uint64_t itemSize) {
+            return offset % 8 == 0 && offset <= m_size && count <= (m_size - offset) / itemSize;
+        };
+        auto powerOfTwo = [](uint32_t n) { return n != 0 && (n & (n - 1)) == 0; };
+        return powerOfTwo(h.entryBuckets) && powerOfTwo(h.tokenBuckets) &&
+               h.entryBuckets > h.entryCount && h.tokenBuckets > h.tokenCount &&
+               fits(h.entriesOffset, h.entryCount, sizeof(SnapshotFormat::EntryRecord)) &&
+               fits(h.entryHashOffset, h.entryBuckets, sizeof(uint32_t)) &&
+               fits(h.tokensOffset, h.tokenCount, sizeof(SnapshotFormat::TokenRecord)) &&
+               fits(h.tokenHashOffset, h.tokenBuckets, sizeof(uint32_t)) &&
+               fits(h.postingsOffset, h.postingCount, sizeof(uint32_t)) &&
+               fits(h.entryTokensOffset, h.entryTokenCount, sizeof(uint32_t)) &&
+               h.stringsOffset <= m_size && h.stringsSize <= m_size - h.stringsOffset;
+    }
+    
+#ifdef _WIN32
+    void map(const std::string &filename) {
+        m_file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                             OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER fileSize;
+        if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) {
+            unmap();
+            throw std::runtime_error("Unable to open snapshot: " + filename);
+        }
+        m_size = static_cast<size_t>(fileSize.QuadPart);
+        m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        m_base = m_mapping ? static_cast<const char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+        if (!m_base) {
+            unmap();
+            throw std::runtime_error("Unable to map snapshot: " + filename);
+        }
+    }
+    
+    void unmap() {
+        if (m_base)
+            UnmapViewOfFile(m_base);
+        if (m_mapping)
+            CloseHandle(m_mapping);
+        if (m_file != INVALID_HANDLE_VALUE)
+            CloseHandle(m_file);
+        m_base = nullptr;
+        m_mapping = nullptr;
+        m_file = INVALID_HANDLE_VALUE;
+    }
+#else
+    void map(const std::string &filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        struct stat info;
+        if (fd < 0 || ::fstat(fd, &info) != 0 || info.st_size == 0) {
+            if (fd >= 0)
+                ::close(fd);
+            throw std::runtime_error("Unable to open snapshot: " + filename);
+        }
+        m_size = static_cast<size_t>(info.st_size);
+        void *address = ::mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED)
+            throw std::runtime_error("Unable to map snapshot: " + filename);
+        m_base = static_cast<const char*>(address);
+    }
+    
+    void unmap() {
+        if (m_base)
+            ::munmap(const_cast<char*>(m_base), m_size);
+        m_base = nullptr;
+    }
+#endif
+};
+
+// -----------------------------
+// Entry Store
+// -----------------------------
+// Columnar question/answer storage. Question and answer bytes live in two
+// contiguous arenas addressed by per-entry offset arrays, and exact lookups go
+// through an open-addressing (linear probing) table of entry ids. Entry ids are
+// dense and assigned in insertion order, matching TokenIndex ids.
+class EntryStore {
+public:
+    static constexpr uint32_t NOT_FOUND = UINT32_MAX;
+    
+    size_t size() const { return m_questionHashes.size(); }
+    
+    // Views stay valid until the next mutation.
+    std::string_view question(uint32_t entryId) const {
+        return std::string_view(m_questions.data() + m_questionOffsets[entryId],
+                                m_questionOffsets[entryId + 1] - m_questionOffsets[entryId]);
+    }
+    
+    std::string_view answer(uint32_t entryId) const {
+        return std::string_view(m_answers.data() + m_answerOffsets[entryId], m_answerLengths[entryId]);
+    }
+    
+    uint32_t find(std::string_view question) const {
+        if (m_slots.empty())
+            return NOT_FOUND;
+        uint64_t hash = SnapshotFormat::hash(question);
+        size_t mask = m_slots.size() - 1;
+        for (size_t slot = hash & mask; m_slots[slot] != NOT_FOUND; slot = (slot + 1) & mask) {
+            uint32_t entryId = m_slots[slot];
+            if (m_questionHashes[entryId] == hash && this->question(entryId) == question)
+                return entryId;
+        }
+        return NOT_FOUND;
+    }
+    
+    // Appends a question that find() does not know yet and returns its id.
+    uint32_t append(std::string_view question, std::string_view answer) {
+        if ((size() + 1) * 10 > m_slots.size() * 7)
+            rehash(std::max<size_t>(m_slots.size() * 2, 16));
+        uint32_t entryId = static_cast<uint32_t>(size());
+        uint64_t hash = SnapshotFormat::hash(question);
+        m_questions.append(question.data(), question.size());
+        m_questionOffsets.push_back(m_questions.size());
+        m_questionHashes.push_back(hash);
+        m_answerOffsets.push_back(m_answers.size());
+        m_answerLengths.push_back(static_cast<uint32_t>(answer.size()));
+        m_answers.append(answer.data(), answer.size());
+        insertSlot(entryId, hash);
+        return entryId;
+    }
+    
+    // Replaces an answer. The new bytes go to the end of the answer arena; the
+    // arena is repacked once superseded answers outweigh live ones.
+    void setAnswer(uint32_t entryId, std::string_view answer) {
+        m_deadAnswerBytes += m_answerLengths[entryId];
+        m_answerOffsets[entryId] = m_answers.size();
+        m_answerLengths[entryId] = static_cast<uint32_t>(answer.size());
+        m_answers.append(answer.data(), answer.size());
+        if (m_deadAnswerBytes > m_answers.size() / 2)
+            repackAnswers();
+    }
+    
+    // Pre-sizes the arrays, arenas and hash table for `entries` more entries.
+    void reserve(size_t entries, size_t questionBytes, size_t answerBytes) {
+        size_t total = size() + entries;
+        reserveGrowth(m_questionOffsets, total + 1);
+        reserveGrowth(m_questionHashes, total);
+        reserveGrowth(m_answerOffsets, total);
+        reserveGrowth(m_answerLengths, total);
+        reserveGrowth(m_questions, m_questions.size() + questionBytes);
+        reserveGrowth(m_answers, m_answers.size() + answerBytes);
+        size_t slots = std::max<size_t>(m_slots.size(), 16);
+        while (total * 10 > slots * 7)
+            slots *= 2;
+        if (slots != m_slots.size())
+            rehash(slots);
+    }
+    
+    void clear() {
+        m_questions.clear();
+        m_answers.clear();
+        m_questionOffsets.assign(1, 0);
+        m_questionHashes.clear();
+        m_answerOffsets.clear();
+        m_answerLengths.clear();
+        m_slots.clear();
+        m_deadAnswerBytes = 0;
+    }
+    
+    // Live question and answer bytes, excluding superseded answers.
+    size_t textBytes() const {
+        return m_questions.size() + m_answers.size() - m_deadAnswerBytes;
+    }
+    
+    // Heap bytes held by the store, for memory benchmarks.
+    size_t memoryUsage() const {
+        return m_questions.capacity() + m_answers.capacity() +
+               m_questionOffsets.capacity() * sizeof(uint64_t) + m_questionHashes.capacity() * sizeof(uint64_t) +
+               m_answerOffsets.capacity() * sizeof(uint64_t) + m_answerLengths.capacity() * sizeof(uint32_t) +
+               m_slots.capacity() * sizeof(uint32_t);
+    }
+
+private:
+    std::string m_questions;                        // Question arena
+    std::string m_answers;                          // Answer arena
+    std::vector<uint64_t> m_questionOffsets{0};     // Entry id -> question start; one extra end offset
+    std::vector<uint64_t> m_questionHashes;         // Entry id -> FNV-1a of the question
+    std::vector<uint64_t> m_answerOffsets;
+    std::vector<uint32_t> m_answerLengths;
+    std::vector<uint32_t> m_slots;                  // Power-of-two table of entry ids, NOT_FOUND = empty
+    size_t m_deadAnswerBytes = 0;
+    
+    void insertSlot(uint32_t entryId, uint64_t hash) {
+        size_t mask = m_slots.size() - 1;
+        size_t slot = hash & mask;
+        while (m_slots[slot] != NOT_FOUND)
+            slot = (slot + 1) & mask;
+        m_slots[slot] = entryId;
+    }
+    
+    void rehash(size_t slotCount) {
+        m_slots.assign(slotCount, NOT_FOUND);
+        for (uint32_t entryId = 0; entryId < size(); ++entryId)
+            insertSlot(entryId, m_questionHashes[entryId]);
+    }
+    
+    void repackAnswers() {
+        std::string packed;
+        packed.reserve(m_answers.size() - m_deadAnswerBytes);
+        for (uint32_t entryId = 0; entryId < size(); ++entryId) {
+            std::string_view current = answer(entryId);
+            m_answerOffsets[entryId] = packed.size();
+            packed.append(current.data(), current.size());
+        }
+        m_answers.swap(packed);
+        m_deadAnswerBytes = 0;
+    }
+};
+
+// -----------------------------
+// Ingest Batch
+// -----------------------------
+// Collects question/answer pairs for KnowledgeBase::addEntries in one growing
+// buffer, for sources whose bytes do not outlive a callback (streamed lines,
+// converted QStrings). Cleared batches keep their capacity.
+class IngestBatch {
+public:
+    void add(std::string_view question, std::string_view answer) {
+        m_offsets.push_back(m_bytes.size());
+        m_bytes.append(question.data(), question.size());
+        m_offsets.push_back(m_bytes.size());
+        m_bytes.append(answer.data(), answer.size());
+    }
+    
+    size_t size() const { return m_offsets.size() / 2; }
+    
+    // Views into the batch, valid until the next add() or clear().
+    const std::vector<std::pair<std::string_view, std::string_view>> &entries() {
+        m_views.clear();
+        for (size_t i = 0; i < m_offsets.size(); i += 2) {
+            size_t answerEnd = i + 2 < m_offsets.size() ? m_offsets[i + 2] : m_bytes.size();
+            m_views.emplace_back(std::string_view(m_bytes).substr(m_offsets[i], m_offsets[i + 1] - m_offsets[i]),
+                                 std::string_view(m_bytes).substr(m_offsets[i + 1], answerEnd - m_offsets[i + 1]));
+        }
+        return m_views;
+    }
+    
+    void clear() {
+        m_bytes.clear();
+        m_offsets.clear();
+        m_views.clear();
+    }
+
+private:
+    std::string m_bytes;
+    std::vector<size_t> m_offsets;   // Question start, answer start, per entry
+    std::vector<std::pair<std::string_view, std::string_view>> m_views;
+};
+
+// -----------------------------
+// Knowledge Base Manager
+// -----------------------------
+class KnowledgeBase {
+public:
+    KnowledgeBase(const std::string &filename, const std::string &key)
+        : m_filename(filename), m_encryptionKey(key) {
+        loadFromFile();
+    }
+    
+    ~KnowledgeBase() {
+        saveToFile();
+        waitForCompaction();
+    }
+    
+    // Loads the snapshot file, then replays the sealed and live journals on top.
+    void loadFromFile() {
+        waitForCompaction();
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        std::ifstream inFile(m_filename, std::ios::binary);
+        if (inFile) {
+            std::error_code error;
+            m_snapshotBytes = std::filesystem::file_size(m_filename, error);
+            try {
+                LineSplitter lines;
+                auto onLine = [this](std::string_view line) { parseLine(line); };
+                Cryptography::decryptFrom(inFile, m_encryptionKey, [&](const char *data, size_t length) {
+                    lines.append(data, length, onLine);
+                });
+                lines.finish(onLine);
+            } catch (const std::exception &) {
+                std::ifstream legacyFile(m_filename, std::ios::binary);
+                std::stringstream buffer;
+                buffer << legacyFile.rdbuf();
+                std::string legacyDecrypted = legacyXorDecrypt(buffer.str(), m_encryptionKey);
+                parseData(legacyDecrypted);
+            }
+        }
+        replayJournal(sealedJournalPath());
+        m_journalBytes = replayJournal(journalPath());
+        maybeCompact();
+    }
+    
+    // Changes are journaled as they happen; this flushes the journal and starts a
+    // background compaction once it has outgrown the snapshot. If a journal write
+    // failed since the last save, it rewrites the snapshot from memory instead and
+    // waits for it. Returns false if that failed too, so some changes exist only
+    // in memory; the next save tries again.
+    bool saveToFile() {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        if (m_journal.is_open() && !m_journal.flush())
+            failJournal();
+        if (!m_journalFailed) {
+            maybeCompact();
+            return true;
+        }
+        startCompaction();
+        m_journalFailed = !waitForCompaction();
+        return !m_journalFailed;
+    }
+    
+    // Rewrites the snapshot from memory and drops the journals, synchronously.
+    void compact() {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        startCompaction();
+        if (waitForCompaction())
+            m_journalFailed = false;
+    }
+    
+    // Also writes a MappedKnowledgeBase snapshot to `path` on every compaction,
+    // from the same copy of the entries; an empty path turns this off. The
+    // mapped snapshot is stored in clear and reflects the last compaction, so
+    // call compact() for an up-to-date one.
+    void setMappedSnapshot(const std::string &path) {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_mappedSnapshotPath = path;
+    }
+    
+    // Journal size, relative to the snapshot, that triggers background compaction.
+    void setCompactionRatio(double ratio) {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_compactionRatio = ratio;
+    }
+    
+    void addEntry(const std::string &question, const std::string &answer) {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        std::string normalizedQuestion = TextProcessor::normalizeString(question);
+        if (insertEntry(normalizedQuestion, answer))
+            appendJournal(JOURNAL_ADD, normalizedQuestion, answer);
+    }
+    
+    // Bulk form of addEntry for imports. Questions are normalized into a reused
+    // arena, storage is reserved once for the whole batch and every change is
+    // journaled as a single record. Later duplicates in a batch win, as with
+    // repeated addEntry calls. Returns the number of entries added or changed.
+    size_t addEntries(const std::vector<std::pair<std::string_view, std::string_view>> &batch) {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_ingestArena.clear();
+        m_ingestSpans.clear();
+        size_t answerBytes = 0;
+        for (const auto &entry : batch) {
+            size_t start = m_ingestArena.size();
+            TextProcessor::normalizeInto(entry.first, m_ingestArena);
+            m_ingestSpans.emplace_back(start, m_ingestArena.size() - start);
+            answerBytes += entry.second.size();
+        }
+        m_entries.reserve(batch.size(), m_ingestArena.size(), answerBytes);
+        m_index.reserve(batch.size(), m_ingestArena.size() / 4);
+        
+        m_ingestJournal.assign(1, JOURNAL_BATCH);
+        appendU32(m_ingestJournal, 0);
+        uint32_t changed = 0;
+        std::string_view arena(m_ingestArena);
+        for (size_t i = 0; i < batch.size(); ++i) {
+            std::string_view question = arena.substr(m_ingestSpans[i].first, m_ingestSpans[i].second);
+            std::string_view answer = batch[i].second;
+            if (!insertEntry(question, answer))
+                continue;
+            appendU32(m_ingestJournal, static_cast<uint32_t>(question.size()));
+            appendU32(m_ingestJournal, static_cast<uint32_t>(answer.size()));
+            m_ingestJournal.append(question.data(), question.size());
+            m_ingestJournal.append(answer.data(), answer.size());
+            ++changed;
+        }
+        if (changed > 0) {
+            std::memcpy(&m_ingestJournal[1], &changed, sizeof(changed));
+            writeJournalRecord(m_ingestJournal);
+        }
+        return changed;
+    }
+    
+    std::string findAnswer(const std::string &question) const {
+        return findAnswerNormalized(TextProcessor::normalizeString(question));
+    }
+    
+    // findAnswer for a question that already went through normalizeString.
+    std::string findAnswerNormalized(const std::string &normalizedQuestion) const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::vector<AnswerMatch> matches = findTopKNormalized(normalizedQuestion, 1);
+        return matches.empty() ? std::string() : matches.front().answer;
+    }
+    
+    // Returns up to k matches, best first. An exact hit comes first with score 1.0,
+    // followed by fuzzy matches above the similarity threshold; equal scores are
+    // ordered oldest entry first.
+    std::vector<AnswerMatch> findTopK(const std::string &question, size_t k) const {
+        std::string normalizedQuestion = TextProcessor::normalizeString(question);
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return findTopKNormalized(normalizedQuestion, k);
+    }
+    
+    std::vector<std::pair<std::string, std::string>> getAllEntries() const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::vector<std::pair<std::string, std::string>> entries;
+        entries.reserve(m_entries.size());
+        for (uint32_t entryId = 0; entryId < m_entries.size(); ++entryId)
+            entries.emplace_back(m_entries.question(entryId), m_entries.answer(entryId));
+        return entries;
+    }
+    
+    // Calls visit(question, answer) for every entry in insertion order without
+    // copying them. Writers wait until the walk is over.
+    template <typename Visitor>
+    void forEachEntry(Visitor &&visit) const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        for (uint32_t entryId = 0; entryId < m_entries.size(); ++entryId)
+            visit(m_entries.question(entryId), m_entries.answer(entryId));
+    }
+    
+    // Writes the current entries as a read-only snapshot for MappedKnowledgeBase.
+    void writeSnapshot(const std::string &filename) const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        std::vector<std::pair<std::string_view, std::string_view>> entries;
+        entries.reserve(m_entries.size());
+        for (uint32_t entryId = 0; entryId < m_entries.size(); ++entryId)
+            entries.emplace_back(m_entries.question(entryId), m_entries.answer(entryId));
+        MappedKnowledgeBase::write(filename, entries);
+    }
+    
+    // Switches fuzzy matching to MinHash/LSH candidate generation. Every returned
+    // answer is still verified with exact Jaccard, but a match the exact index
+    // would find can be missed.
+    void enableApproximateMatching(uint32_t bands = 20, uint32_t rows = 5, size_t maxCandidates = 64) {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_scanPool.reset();
+        m_generation.fetch_add(1, std::memory_order_release);
+        m_approximateIndex = std::make_unique<MinHashIndex>(bands, rows, maxCandidates);
+        for (uint32_t entryId = 0; entryId < m_entries.size(); ++entryId)
+            m_approximateIndex->addEntry(entryId, m_index.entryTokens(entryId), m_index.entryLength(entryId));
+    }
+    
+    void disableApproximateMatching() {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_generation.fetch_add(1, std::memory_order_release);
+        m_approximateIndex.reset();
+    }
+    
+    // Scores every entry instead of only index candidates, split into contiguous
+    // shards across `threads` threads. Results are identical to indexed matching,
+    // ties included; this mode exists for audits that want every entry checked.
+    void enableExhaustiveMatching(size_t threads = std::thread::hardware_concurrency()) {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_approximateIndex.reset();
+        m_generation.fetch_add(1, std::memory_order_release);
+        m_scanPool = std::make_unique<ScanPool>(threads);
+    }
+    
+    void disableExhaustiveMatching() {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        m_generation.fetch_add(1, std::memory_order_release);
+        m_scanPool.reset();
+    }
+    
+    void clear() {
+        std::unique_lock<std::shared_mutex> lock(m_mutex);
+        if (m_entries.size() > 0)
+            appendJournal(JOURNAL_CLEAR, std::string(), std::string());
+        resetEntries();
+    }
+    
+    size_t size() const {
+        std::shared_lock<std::shared_mutex> lock(m_mutex);
+        return m_entries.size();
+    }
+    
+    // Bumped by every change that can alter a lookup result (entries added,
+    // changed or cleared, matching mode switched), so callers can cache answers.
+    uint64_t generation() const {
+        return m_generation.load(std::memory_order_acquire);
+    }
+
+private:
+    // Lookups (possibly from QueryEngine workers) share the lock; mutations and
+    // file I/O take it exclusively. Private helpers expect it to be held.
+    mutable std::shared_mutex m_mutex;
+    std::string m_filename;
+    std::string m_encryptionKey;
+    EntryStore m_entries;
+    TokenIndex m_index;
+    std::unique_ptr<MinHashIndex> m_approximateIndex;   // Optional LSH candidates
+    std::unique_ptr<ScanPool> m_scanPool;               // Set in exhaustive matching mode
+    std::atomic<uint64_t> m_generation{0};
+    
+    static constexpr size_t MIN_SHARD_ENTRIES = 4096;
+    
+    // Body of findTopK; expects the shared lock to be held.
+    std::vector<AnswerMatch> findTopKNormalized(const std::string &normalizedQuestion, size_t k) const {
+        std::vector<AnswerMatch> matches;
+        if (k == 0)
+            return matches;
+        uint32_t exactId = m_entries.find(normalizedQuestion);
+        if (exactId != EntryStore::NOT_FOUND) {
+            matches.push_back({std::string(m_entries.answer(exactId)), 1.0, exactId});
+            if (k == 1)
+                return matches;
+            --k;
+        }
+        const double SIMILARITY_THRESHOLD = 0.8;
+        std::vector<uint32_t> query = m_index.encodeQuery(TextProcessor::tokenize(normalizedQuestion));
+        TokenSignature querySignature = TokenIndex::signature(query);
+        std::vector<TopKCollector::Scored> scored;
+        if (m_scanPool) {
+            scored = exhaustiveScan(query, querySignature, exactId, k, SIMILARITY_THRESHOLD);
+        } else {
+            std::vector<uint32_t> candidates = m_approximateIndex
+                ? m_approximateIndex->candidates(query.data(), query.size())
+                : m_index.candidates(query, SIMILARITY_THRESHOLD);
+            TopKCollector best(k, SIMILARITY_THRESHOLD);
+            for (uint32_t entryId : candidates)
+                score(best, query, querySignature, exactId, entryId);
+            scored = best.takeSorted();
+        }
+        for (const auto &match : scored)
+            matches.push_back({std::string(m_entries.answer(match.second)), match.first, match.second});
+        return matches;
+    }
+    
+    void score(TopKCollector &best, const std::vector<uint32_t> &query, const TokenSignature &querySignature,
+               uint32_t exactId, uint32_t entryId) const {
+        if (entryId == exactId)
+            return;
+        if (m_index.similarityUpperBound(querySignature, query.size(), entryId) <= best.minScore())
+            return;
+        best.offer(m_index.similarity(query, entryId), entryId);
+    }
+    
+    // Each shard keeps its own top k over a contiguous id range; the union of
+    // those holds the global top k, which is picked with the serial tie-break
+    // (higher score, then lower entry id).
+    std::vector<TopKCollector::Scored> exhaustiveScan(const std::vector<uint32_t> &query,
+                                                      const TokenSignature &querySignature,
+                                                      uint32_t exactId, size_t k, double threshold) const {
+        const size_t entryCount = m_entries.size();
+        const size_t shards = std::max<size_t>(1, std::min(m_scanPool->threadCount() * 4,
+                                                           entryCount / MIN_SHARD_ENTRIES));
+        std::vector<std::vector<TopKCollector::Scored>> shardResults(shards);
+        auto scanShard = [&](size_t shard) {
+            uint32_t begin = static_cast<uint32_t>(entryCount * shard / shards);
+            uint32_t end = static_cast<uint32_t>(entryCount * (shard + 1) / shards);
+            TopKCollector best(k, threshold);
+            for (uint32_t entryId = begin; entryId < end; ++entryId)
+                score(best, query, querySignature, exactId, entryId);
+            shardResults[shard] = best.takeSorted();
+        };
+        if (shards == 1)
+            scanShard(0);
+        else
+            m_scanPool->run(shards, scanShard);
+        
+        std::vector<TopKCollector::Scored> merged;
+        for (auto &result : shardResults)
+            merged.insert(merged.end(), result.begin(), result.end());
+        auto better = [](const TopKCollector::Scored &a, const TopKCollector::Scored &b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        };
+        if (merged.size() > k) {
+            std::partial_sort(merged.begin(), merged.begin() + k, merged.end(), better);
+            merged.resize(k);
+        } else {
+            std::sort(merged.begin(), merged.end(), better);
+        }
+        return merged;
+    }
+    
+    // Write-ahead journal. Each record is [u32 length][u32 FNV-1a checksum]
+    // followed by an encrypted payload of [op][u32 question length][question][answer].
+    // A torn or corrupt tail is truncated on load. Records are flushed to the OS
+    // as they are written but not fsynced, so they survive the process crashing,
+    // not a power failure or OS crash; the same holds for compaction's rename.
+    // A batch payload is [op][u32 count] then count x [u32 question length]
+    // [u32 answer length][question][answer].
+    static constexpr char JOURNAL_ADD = 'A';
+    static constexpr char JOURNAL_CLEAR = 'C';
+    static constexpr char JOURNAL_BATCH = 'B';
+    static constexpr uint64_t MIN_COMPACTION_BYTES = 64 * 1024;
+    
+    std::ofstream m_journal;
+    uint64_t m_journalBytes = 0;
+    uint64_t m_snapshotBytes = 0;
+    double m_compactionRatio = 1.0;
+    bool m_journalFailed = false;                   // A record was lost; the next save rewrites the snapshot
+    std::future<bool> m_compaction;                 // Yields whether the snapshot was replaced
+    std::string m_mappedSnapshotPath;               // Empty: compaction writes no mapped snapshot
+    
+    // Scratch buffers reused by addEntries.
+    std::string m_ingestArena;
+    std::vector<std::pair<size_t, size_t>> m_ingestSpans;
+    std::string m_ingestJournal;
+    
+    std::string journalPath() const { return m_filename + ".journal"; }
+    std::string sealedJournalPath() const { return m_filename + ".journal.sealed"; }
+    
+    static uint32_t checksum(const std::string &data) {
+        uint32_t h = 2166136261u;
+        for (unsigned char c : data) {
+            h ^= c;
+            h *= 16777619u;
+        }
+        return h;
+    }
+    
+    static void appendU32(std::string &out, uint32_t value) {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+    
+    void appendJournal(char op, const std::string &question, const std::string &answer) {
+        std::string payload(1, op);
+        appendU32(payload, static_cast<uint32_t>(question.size()));
+        payload += question;
+        payload += answer;
+        writeJournalRecord(payload);
+    }
+    
+    void writeJournalRecord(const std::string &payload) {
+        if (!m_journal.is_open())
+            m_journal.open(journalPath(), std::ios::binary | std::ios::app);
+        std::string record = Cryptography::encrypt(payload, m_encryptionKey);
+        uint32_t header[2] = {static_cast<uint32_t>(record.size()), checksum(record)};
+        m_journal.write(reinterpret_cast<const char*>(header), sizeof(header));
+        m_journal.write(record.data(), static_cast<std::streamsize>(record.size()));
+        m_journal.flush();
+        if (!m_journal) {
+            failJournal();
+            return;
+        }
+        m_journalBytes += sizeof(header) + record.size();
+    }
+    
+    // After a failed write (disk full, say) part of a record may be on disk. The
+    // journal is cut back to its last whole record, so records written after it
+    // still replay, and reopened by the next write.
+    void failJournal() {
+        m_journal.clear();
+        m_journal.close();
+        std::error_code error;
+        std::filesystem::resize_file(journalPath(), m_journalBytes, error);
+        m_journalFailed = true;
+    }
+    
+    // Applies every intact record and returns the byte length of the valid prefix.
+    uint64_t replayJournal(const std::string &path) {
+        std::ifstream inFile(path, std::ios::binary);
+        std::error_code error;
+        uint64_t fileBytes = std::filesystem::file_size(path, error);
+        if (!inFile || error)
+            return 0;
+        uint64_t validBytes = 0;
+        uint32_t header[2];
+        std::string record;
+        while (inFile.read(reinterpret_cast<char*>(header), sizeof(header))) {
+            if (header[0] > fileBytes - validBytes - sizeof(header))
+                break;
+            record.resize(header[0]);
+            if (!inFile.read(&record[0], static_cast<std::streamsize>(record.size())) || checksum(record) != header[1])
+                break;
+            std::string payload = Cryptography::decrypt(record, m_encryptionKey);
+            uint32_t questionLength = 0;
+            if (payload.size() < 1 + sizeof(questionLength))
+                break;
+            std::memcpy(&questionLength, payload.data() + 1, sizeof(questionLength));
+            if (payload.size() - 1 - sizeof(questionLength) < questionLength)
+                break;
+            if (payload[0] == JOURNAL_CLEAR) {
+                resetEntries();
+            } else if (payload[0] == JOURNAL_ADD) {
+                size_t questionStart = 1 + sizeof(questionLength);
+                insertEntry(payload.substr(questionStart, questionLength),
+                            payload.substr(questionStart + questionLength));
+            } else if (payload[0] == JOURNAL_BATCH && !replayBatch(payload)) {
+                break;
+            }
+            validBytes += sizeof(header) + record.size();
+        }
+        inFile.close();
+        if (validBytes < fileBytes)
+            std::filesystem::resize_file(path, validBytes, error);
+        return validBytes;
+    }
+    
+    // Applies a batch record; false if it is malformed.
+    bool replayBatch(std::string_view payload) {
+        uint32_t count = 0;
+        std::memcpy(&count, payload.data() + 1, sizeof(count));
+        size_t pos = 1 + sizeof(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            uint32_t lengths[2];
+            if (payload.size() - pos < sizeof(lengths))
+                return false;
+            std::memcpy(lengths, payload.data() + pos, sizeof(lengths));
+            pos += sizeof(lengths);
+            if (payload.size() - pos < static_cast<uint64_t>(lengths[0]) + lengths[1])
+                return false;
+            insertEntry(payload.substr(pos, lengths[0]), payload.substr(pos + lengths[0], lengths[1]));
+            pos += static_cast<size_t>(lengths[0]) + lengths[1];
+        }
+        return true;
+    }
+    
+    bool compactionRunning() const {
+        return m_compaction.valid() &&
+               m_compaction.wait_for(std::chrono::seconds(0)) != std::future_status::ready;
+    }
+    
+    // Returns whether the last compaction replaced the snapshot.
+    bool waitForCompaction() {
+        return !m_compaction.valid() || m_compaction.get();
+    }
+    
+    void maybeCompact() {
+        std::error_code error;
+        bool sealedPending = std::filesystem::exists(sealedJournalPath(), error);
+        bool oversized = m_journalBytes > MIN_COMPACTION_BYTES &&
+                         m_journalBytes > m_compactionRatio * m_snapshotBytes;
+        if ((sealedPending || oversized) && !compactionRunning())
+            startCompaction();
+    }
+    
+    // Copies the entry arenas and seals the live journal on the calling thread,
+    // then formats, encrypts and writes the new snapshot from that copy in the
+    // background. The snapshot goes to a temporary file that is atomically
+    // renamed over the old one before the sealed journal is removed; replaying a
+    // journal over a snapshot that already contains its records is harmless, so
+    // a process crash at any point loses nothing.
+    void startCompaction() {
+        waitForCompaction();
+        if (m_journal.is_open())
+            m_journal.close();
+        std::error_code error;
+        if (!std::filesystem::exists(sealedJournalPath(), error) && std::filesystem::exists(journalPath(), error)) {
+            std::filesystem::rename(journalPath(), sealedJournalPath(), error);
+            if (!error)
+                m_journalBytes = 0;
+        }
+        
+        std::string filename = m_filename;
+        std::string sealedPath = sealedJournalPath();
+        std::string key = m_encryptionKey;
+        std::string mappedPath = m_mappedSnapshotPath;
+        m_snapshotBytes = m_entries.size() == 0 ? 0 : m_entries.textBytes() + 4 * m_entries.size() + Cryptography::IV_SIZE;
+        m_compaction = std::async(std::launch::async, [filename, sealedPath, key, mappedPath, entries = m_entries]() {
+            std::string tempPath = filename + ".tmp";
+            {
+                std::ofstream outFile(tempPath, std::ios::binary | std::ios::trunc);
+                if (!outFile || !writeEntries(outFile, entries, key))
+                    return false;
+                outFile.flush();
+                if (!outFile)
+                    return false;
+            }
+            std::error_code error;
+            std::filesystem::rename(tempPath, filename, error);
+            if (error)
+                return false;
+            std::filesystem::remove(sealedPath, error);
+            if (!mappedPath.empty())
+                writeMappedSnapshot(mappedPath, entries);
+            return true;
+        });
+    }
+    
+    // Replaces the mapped snapshot through a temporary file, so processes that
+    // still have the old one mapped keep a consistent view. Best effort, like
+    // the rest of the background compaction.
+    static void writeMappedSnapshot(const std::string &path, const EntryStore &entries) {
+        std::vector<std::pair<std::string_view, std::string_view>> views;
+        views.reserve(entries.size());
+        for (uint32_t entryId = 0; entryId < entries.size(); ++entryId)
+            views.emplace_back(entries.question(entryId), entries.answer(entryId));
+        std::string tempPath = path + ".tmp";
+        std::error_code error;
+        try {
+            MappedKnowledgeBase::write(tempPath, views);
+        } catch (const std::exception &) {
+            std::filesystem::remove(tempPath, error);
+            return;
+        }
+        std::filesystem::rename(tempPath, path, error);
+    }
+    
+    // Streams entries as encrypted "question|||answer" lines, one block at a time.
+    static bool writeEntries(std::ostream &out, const EntryStore &entries, const std::string &key) {
+        Cryptography::Encryptor encryptor(out, key);
+        std::string block;
+        block.reserve(Cryptography::BLOCK_SIZE);
+        for (uint32_t entryId = 0; entryId < entries.size(); ++entryId) {
+            block += entries.question(entryId);
+            block += "|||";
+            block += entries.answer(entryId);
+            block += '\n';
+            if (block.size() >= Cryptography::BLOCK_SIZE) {
+                if (!encryptor.update(&block[0], block.size()))
+                    return false;
+                block.clear();
+            }
+        }
+        return encryptor.update(&block[0], block.size());
+    }
+    
+    void resetEntries() {
+        m_generation.fetch_add(1, std::memory_order_release);
+        m_entries.clear();
+        m_index.clear();
+        if (m_approximateIndex)
+            m_approximateIndex->clear();
+    }
+    
+    bool insertEntry(std::string_view question, std::string_view answer) {
+        uint32_t existing = m_entries.find(question);
+        if (existing != EntryStore::NOT_FOUND) {
+            if (m_entries.answer(existing) == answer)
+                return false;
+            m_entries.setAnswer(existing, answer);
+            m_generation.fetch_add(1, std::memory_order_release);
+            return true;
+        }
+        m_generation.fetch_add(1, std::memory_order_release);
+        uint32_t entryId = m_index.addEntry(question);
+        m_entries.append(question, answer);
+        if (m_approximateIndex)
+            m_approximateIndex->addEntry(entryId, m_index.entryTokens(entryId), m_index.entryLength(entryId));
+        return true;
+    }
+    
+    void parseData(const std::string &data) {
+        std::istringstream iss(data);
+        std::string line;
+        while (std::getline(iss, line))
+            parseLine(line);
+    }
+    
+    void parseLine(std::string_view line) {
+        size_t pos = line.find("|||");
+        if (pos == std::string_view::npos)
+            return;
+        insertEntry(line.substr(0, pos), line.substr(pos + 3));
+    }
+    
+    std::string legacyXorDecrypt(const std::string &data, const std::string &key) {
+        std::string result = data;
+        for (size_t i = 0; i < data.size(); ++i)
+            result[i] = data[i] ^ key[i % key.size()];
+        return result;
+    }
+};
+
+// -----------------------------
+// Intent Matcher
+// -----------------------------
+// Intent rules: phrases that trigger an intent and the replies it picks from.
+// The file format is one rule per line, '#' starts a comment:
+//   greeting: good morning         phrase, matched anywhere in the normalized message
+//   greeting = Hi! What can I do?  reply
+// Intents take priority in the order they first appear.
+struct IntentRules {
+    std::vector<std::string> intents;
+    std::vector<std::pair<uint32_t, std::string>> phrases;   // Intent index, normalized phrase
+    std::vector<std::vector<std::string>> responses;         // Per intent
+    
+    uint32_t intentId(const std::string &name) {
+        auto it = std::find(intents.begin(), intents.end(), name);
+        if (it != intents.end())
+            return static_cast<uint32_t>(it - intents.begin());
+        intents.push_back(name);
+        responses.emplace_back();
+        return static_cast<uint32_t>(intents.size() - 1);
+    }
+    
+    void addPhrase(const std::string &intent, const std::string &phrase) {
+        std::string normalized = TextProcessor::normalizeString(phrase);
+        if (!normalized.empty())
+            phrases.emplace_back(intentId(intent), std::move(normalized));
+    }
+    
+    void addResponse(const std::string &intent, const std::string &response) {
+        responses[intentId(intent)].push_back(response);
+    }
+    
+    static IntentRules parse(std::istream &in, const std::string &source) {
+        IntentRules rules;
+        std::string line;
+        for (size_t lineNumber = 1; std::getline(in, line); ++lineNumber) {
+            auto trim = [](std::string_view text) {
+                size_t begin = text.find_first_not_of(" \t\r");
+                size_t end = text.find_last_not_of(" \t\r");
+                return begin == std::string_view::npos ? std::string() : std::string(text.substr(begin, end - begin + 1));
+            };
+            std::string rule = trim(line);
+            if (rule.empty() || rule[0] == '#')
+                continue;
+            size_t nameEnd = 0;
+            while (nameEnd < rule.size() && (std::isalnum(static_cast<unsigned char>(rule[nameEnd])) ||
+                                             rule[nameEnd] == '_' || rule[nameEnd] == '-'))
+                ++nameEnd;
+            std::string name = rule.substr(0, nameEnd);
+            std::string rest = trim(std::string_view(rule).substr(nameEnd));
+            if (name.empty() || rest.empty() || (rest[0] != ':' && rest[0] != '=') || trim(rest.substr(1)).empty())
+                throw std::runtime_error(source + ":" + std::to_string(lineNumber) +
+                                         ": expected 'intent: phrase' or 'intent = response'");
+            if (rest[0] == ':')
+                rules.addPhrase(name, trim(rest.substr(1)));
+            else
+                rules.addResponse(name, trim(rest.substr(1)));
+        }
+        return rules;
+    }
+    
+    static IntentRules load(const std::string &path) {
+        std::ifstream in(path);
+        if (!in)
+            throw std::runtime_error("Cannot open intent rules " + path);
+        return parse(in, path);
+    }
+    
+    // The built-in greeting and farewell rules, used when no rules file is given.
+    static IntentRules defaults() {
+        IntentRules rules;
+        for (const char *phrase : {"hello", "hi", "hey", "greetings", "good morning", "good afternoon",
+                                   "good evening", "howdy"})
+            rules.addPhrase("greeting", phrase);
+        for (const char *response : {"Hello there! How can I help you today?",
+                                     "Hi! What can I do for you?",
+                                     "Greetings! How may I assist you?",
+                                     "Hello! I'm ready to help. What do you need?",
+                                     "Hey there! What's on your mind today?"})
+            rules.addResponse("greeting", response);
+        for (const char *phrase : {"bye", "goodbye", "see you", "farewell", "later", "take care"})
+            rules.addPhrase("farewell", phrase);
+        for (const char *response : {"Goodbye! Have a great day!",
+                                     "See you later! Feel free to chat again anytime.",
+                                     "Farewell! It was nice chatting with you.",
+                                     "Take care! Come back soon.",
+                                     "Bye for now! I'll be here if you need anything else."})
+            rules.addResponse("farewell", response);
+        return rules;
+    }
+};
+
+// Aho-Corasick automaton over every intent phrase, built once. It is stored as
+// a full DFA over the bytes that occur in phrases (all other bytes share one
+// class), so matching is one table lookup per input byte regardless of how many
+// phrases there are. Each state carries the set of intents whose phrases end
+// there, suffixes included.
+class IntentMatcher {
+public:
+    static constexpr size_t MAX_INTENTS = 64;
+    
+    explicit IntentMatcher(IntentRules rules) : m_rules(std::move(rules)) {
+        if (m_rules.intents.size() > MAX_INTENTS)
+            throw std::invalid_argument("IntentMatcher supports at most 64 intents");
+        m_classOf.fill(0);
+        for (const auto &phrase : m_rules.phrases)
+            for (unsigned char c : phrase.second)
+                if (m_classOf[c] == 0)
+                    m_classOf[c] = static_cast<uint16_t>(++m_classCount);
+        ++m_classCount;   // Class 0: bytes in no phrase
+        
+        // Trie, with NO_STATE for missing edges.
+        const uint32_t NO_STATE = std::numeric_limits<uint32_t>::max();
+        m_next.assign(m_classCount, NO_STATE);
+        m_output.assign(1, 0);
+        for (const auto &phrase : m_rules.phrases) {
+            uint32_t state = 0;
+            for (unsigned char c : phrase.second) {
+                uint32_t &edge = m_next[state * m_classCount + m_classOf[c]];
+                if (edge == NO_STATE) {
+                    edge = static_cast<uint32_t>(m_output.size());
+                    m_output.push_back(0);
+                    m_next.resize(m_next.size() + m_classCount, NO_STATE);
+                }
+                state = m_next[state * m_classCount + m_classOf[c]];
+            }
+            m_output[state] |= uint64_t(1) << phrase.first;
+        }
+        
+        // Breadth-first, so a state's failure target is complete before the state.
+        std::vector<uint32_t> failure(m_output.size(), 0);
+        std::deque<uint32_t> queue;
+        for (size_t c = 0; c < m_classCount; ++c) {
+            uint32_t &edge = m_next[c];
+            if (edge == NO_STATE) {
+                edge = 0;
+            } else {
+                failure[edge] = 0;
+                queue.push_back(edge);
+            }
+        }
+        while (!queue.empty()) {
+            uint32_t state = queue.front();
+            queue.pop_front();
+            m_output[state] |= m_output[failure[state]];
+            for (size_t c = 0; c < m_classCount; ++c) {
+                uint32_t &edge = m_next[state * m_classCount + c];
+                uint32_t fallback = m_next[failure[state] * m_classCount + c];
+                if (edge == NO_STATE) {
+                    edge = fallback;
+                } else {
+                    failure[edge] = fallback;
+                    queue.push_back(edge);
+                }
+            }
+        }
+    }
+    
+    // Bit i is set when a phrase of intent i occurs in `text`.
+    uint64_t match(std::string_view text) const {
+        uint64_t intents = 0;
+        uint32_t state = 0;
+        for (unsigned char c : text) {
+            state = m_next[state * m_classCount + m_classOf[c]];
+            intents |= m_output[state];
+        }
+        return intents;
+    }
+    
+    const IntentRules &rules() const { return m_rules; }
+    size_t stateCount() const { return m_output.size(); }
+
+private:
+    IntentRules m_rules;
+    std::array<uint16_t, 256> m_classOf;
+    size_t m_classCount = 0;
+    std::vector<uint32_t> m_next;     // State * m_classCount + byte class
+    std::vector<uint64_t> m_output;   // Intents matched on entering each state
+};
+
+// -----------------------------
+// Answer Cache
+// -----------------------------
+// Bounded cache of responses keyed by normalized question, shared by every
+// thread that answers questions. Each value is tagged with the knowledge-base
+// generation it was computed at and only served while that generation is
+// current, so no explicit invalidation is needed. Known misses are cached too.
+// Keys are spread over shards, each with its own lock and CLOCK eviction: a
+// hit only sets the slot's reference bit, and the hand clears bits until it
+// finds a slot that has not been used since its last pass.
+class AnswerCache {
+public:
+    enum class Kind : uint8_t {
+        Answer,      // Knowledge-base answer; empty for a known miss
+        Intent       // Reply picked from the intent's responses
+    };
+    
+    struct Value {
+        Kind kind = Kind::Answer;
+        uint32_t intent = 0;
+        std::string answer;
+    };
+    
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;      // Includes entries from an older generation
+        size_t entries = 0;
+        size_t capacity = 0;
+        
+        double hitRatio() const {
+            return hits + misses > 0 ? static_cast<double>(hits) / (hits + misses) : 0.0;
+        }
+    };
+    
+    // A capacity of 0 disables caching.
+    explicit AnswerCache(size_t capacity) : m_capacity(capacity) {
+        if (capacity == 0)
+            return;
+        m_shardCount = std::min<size_t>(MAX_SHARDS, capacity);
+        m_shards = std::make_unique<Shard[]>(m_shardCount);
+        for (size_t i = 0; i < m_shardCount; ++i) {
+            m_shards[i].slots.resize(capacity / m_shardCount + (i < capacity % m_shardCount));
+            m_shards[i].index.reserve(m_shards[i].slots.size());
+        }
+    }
+    
+    bool lookup(const std::string &key, uint64_t generation, Value &value) {
+        if (m_shardCount == 0)
+            return false;
+        Shard &shard = shardFor(key);
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            auto it = shard.index.find(key);
+            if (it != shard.index.end() && shard.slots[it->second].generation == generation) {
+                Slot &slot = shard.slots[it->second];
+                slot.referenced = true;
+                value = slot.value;
+                m_hits.fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        m_misses.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    
+    void insert(const std::string &key, uint64_t generation, Value value) {
+        if (m_shardCount == 0)
+            return;
+        Shard &shard = shardFor(key);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        size_t slotIndex;
+        if (it != shard.index.end()) {
+            slotIndex = it->second;
+        } else {
+            slotIndex = shard.evict();
+            Slot &slot = shard.slots[slotIndex];
+            slot.key = key;
+            slot.used = true;
+            shard.index.emplace(std::string_view(slot.key), slotIndex);
+        }
+        Slot &slot = shard.slots[slotIndex];
+        slot.value = std::move(value);
+        slot.generation = generation;
+        slot.referenced = true;
+    }
+    
+    void clear() {
+        for (size_t i = 0; i < m_shardCount; ++i) {
+            std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+            m_shards[i].index.clear();
+            for (Slot &slot : m_shards[i].slots)
+                slot = Slot();
+        }
+    }
+    
+    Stats stats() const {
+        Stats stats;
+        stats.hits = m_hits.load(std::memory_order_relaxed);
+        stats.misses = m_misses.load(std::memory_order_relaxed);
+        stats.capacity = m_capacity;
+        for (size_t i = 0; i < m_shardCount; ++i) {
+            std::lock_guard<std::mutex> lock(m_shards[i].mutex);
+            stats.entries += m_shards[i].index.size();
+        }
+        return stats;
+    }
+    
+    void resetStats() {
+        m_hits.store(0, std::memory_order_relaxed);
+        m_misses.store(0, std::memory_order_relaxed);
+    }
+
+private:
+    static constexpr size_t MAX_SHARDS = 16;
+    
+    struct Slot {
+        std::string key;
+        Value value;
+        uint64_t generation = 0;
+        bool referenced = false;
+        bool used = false;
+    };
+    
+    struct Shard {
+        mutable std::mutex mutex;
+        std::vector<Slot> slots;                             // Never reallocated
+        std::unordered_map<std::string_view, size_t> index;  // Views into slot keys
+        size_t hand = 0;
+        
+        // Frees the next slot the CLOCK hand settles on and returns its index.
+        size_t evict() {
+            while (slots[hand].used && slots[hand].referenced) {
+                slots[hand].referenced = false;
+                hand = (hand + 1) % slots.size();
+            }
+            size_t victim = hand;
+            hand = (hand + 1) % slots.size();
+            if (slots[victim].used)
+                index.erase(slots[victim].key);
+            return victim;
+        }
+    };
+    
+    size_t m_capacity;
+    size_t m_shardCount = 0;
+    std::unique_ptr<Shard[]> m_shards;
+    std::atomic<uint64_t> m_hits{0};
+    std::atomic<uint64_t> m_misses{0};
+    
+    Shard &shardFor(const std::string &key) {
+        return m_shards[std::hash<std::string>()(key) % m_shardCount];
+    }
+};
+
+// -----------------------------
+// Chat Response Generator
+// -----------------------------
+class ChatResponseGenerator {
+public:
+    static constexpr size_t DEFAULT_CACHE_CAPACITY = 4096;
+    
+    // Without intent rules the built-in greeting and farewell rules are used.
+    ChatResponseGenerator(std::shared_ptr<KnowledgeBase> kb, size_t cacheCapacity = DEFAULT_CACHE_CAPACITY,
+                          std::shared_ptr<const IntentMatcher> intents = nullptr)
+        : m_knowledgeBase(kb), m_cache(cacheCapacity),
+          m_intents(intents ? std::move(intents) : std::make_shared<IntentMatcher>(IntentRules::defaults())) {}
+    
+    // Safe to call from several threads at once.
+    std::string generateResponse(const std::string &question) {
+        std::string normalizedQuestion = TextProcessor::normalizeString(question);
+        uint64_t generation = m_knowledgeBase->generation();
+        AnswerCache::Value value;
+        if (!m_cache.lookup(normalizedQuestion, generation, value)) {
+            if (!detectIntent(normalizedQuestion, value.intent))
+                value.answer = m_knowledgeBase->findAnswerNormalized(normalizedQuestion);
+            else
+                value.kind = AnswerCache::Kind::Intent;
+            m_cache.insert(normalizedQuestion, generation, value);
+        }
+        if (value.kind == AnswerCache::Kind::Intent)
+            return randomResponse(value.intent);
+        return value.answer;
+    }
+    
+    AnswerCache::Stats cacheStats() const { return m_cache.stats(); }
+
+private:
+    std::shared_ptr<KnowledgeBase> m_knowledgeBase;
+    AnswerCache m_cache;
+    std::shared_ptr<const IntentMatcher> m_intents;
+    
+    // First intent, in rule order, that matches and has something to say.
+    bool detectIntent(const std::string &text, uint32_t &intent) const {
+        uint64_t matched = m_intents->match(text);
+        const IntentRules &rules = m_intents->rules();
+        for (uint32_t i = 0; matched != 0 && i < rules.intents.size(); ++i, matched >>= 1) {
+            if ((matched & 1) && !rules.responses[i].empty()) {
+                intent = i;
+                return true;
+            }
+        }
+        return false;
+    }
+    
+    std::string randomResponse(uint32_t intent) const {
+        const std::vector<std::string> &responses = m_intents->rules().responses[intent];
+        thread_local std::mt19937 gen(std::random_device{}());
+        std::uniform_int_distribution<size_t> dis(0, responses.size() - 1);
+        return responses[dis(gen)];
+    }
+};
+
+// -----------------------------
+// Async Query Engine
+// -----------------------------
+// Thrown into the future of a query that was cancelled before it ran.
+class QueryCancelled : public std::runtime_error {
+public:
+    QueryCancelled() : std::runtime_error("Query cancelled") {}
+};
+
+// Runs ChatResponseGenerator lookups on a small worker pool so callers (the GUI
+// thread in particular) never block on a knowledge-base scan. Every query gets
+// a ticket; cancelPending() drops queued queries and discards the result of
+// any query already running, so only the latest question gets an answer.
+class QueryEngine {
+public:
+    using Callback = std::function<void(uint64_t ticket, const std::string &response)>;
+    // Receives the what() of the exception a lookup threw.
+    using ErrorCallback = std::function<void(uint64_t ticket, const std::string &error)>;
+
+    QueryEngine(std::shared_ptr<ChatResponseGenerator> generator,
+                size_t threads = std::max(2u, std::thread::hardware_concurrency()) - 1)
+        : m_generator(std::move(generator)) {
+        for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i)
+            m_workers.emplace_back([this] { workerLoop(); });
+    }
+
+    ~QueryEngine() {
+        cancelPending();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stopping = true;
+        }
+        m_wakeUp.notify_all();
+        for (auto &worker : m_workers)
+            worker.join();
+    }
+
+    QueryEngine(const QueryEngine &) = delete;
+    QueryEngine &operator=(const QueryEngine &) = delete;
+
+    // Queues a question; onResult, or onError if the lookup throws, runs on a
+    // worker thread unless the query is cancelled first. Returns the query's
+    // ticket.
+    uint64_t submit(const std::string &question, Callback onResult, ErrorCallback onError) {
+        uint64_t ticket;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            ticket = m_nextTicket++;
+            m_queue.push_back({ticket, question, std::move(onResult), std::move(onError), nullptr});
+        }
+        m_wakeUp.notify_one();
+        return ticket;
+    }
+
+    // Queues a question for callers that prefer to wait; the future throws
+    // QueryCancelled if cancelPending() overtakes it.
+    std::future<std::string> submit(const std::string &question) {
+        auto promise = std::make_shared<std::promise<std::string>>();
+        std::future<std::string> result = promise->get_future();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_queue.push_back({m_nextTicket++, question, nullptr, nullptr, promise});
+        }
+        m_wakeUp.notify_one();
+        return result;
+    }
+
+    // Cancels every query submitted so far, queued or running.
+    void cancelPending() {
+        std::deque<Job> dropped;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_cancelBefore = m_nextTicket;
+            dropped.swap(m_queue);
+        }
+        for (auto &job : dropped)
+            cancel(job);
+    }
+
+    bool isCancelled(uint64_t ticket) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return ticket < m_cancelBefore;
+    }
+
+private:
+    struct Job {
+        uint64_t ticket;
+        std::string question;
+        Callback onResult;
+        ErrorCallback onError;
+        std::shared_ptr<std::promise<std::string>> promise;
+    };
+
+    std::shared_ptr<ChatResponseGenerator> m_generator;
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::deque<Job> m_queue;
+    std::vector<std::thread> m_workers;
+    uint64_t m_nextTicket = 0;
+    uint64_t m_cancelBefore = 0;   // Tickets below this are stale
+    bool m_stopping = false;
+
+    static void cancel(Job &job) {
+        if (job.promise)
+            job.promise->set_exception(std::make_exception_ptr(QueryCancelled()));
+    }
+
+    void workerLoop() {
+        for (;;) {
+            Job job;
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_wakeUp.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+                if (m_queue.empty())
+                    return;
+                job = std::move(m_queue.front());
+                m_queue.pop_front();
+            }
+            run(job);
+        }
+    }
+
+    void run(Job &job) {
+        std::string response;
+        try {
+            response = m_generator->generateResponse(job.question);
+        } catch (const std::exception &e) {
+            fail(job, e.what());
+            return;
+        } catch (...) {
+            fail(job, "unknown error");
+            return;
+        }
+        if (isCancelled(job.ticket)) {
+            cancel(job);
+            return;
+        }
+        if (job.promise)
+            job.promise->set_value(std::move(response));
+        else if (job.onResult)
+            job.onResult(job.ticket, response);
+    }
+
+    // Called from the handler of the exception a lookup threw.
+    void fail(Job &job, const char *error) {
+        if (job.promise)
+            job.promise->set_exception(std::current_exception());
+        else if (job.onError && !isCancelled(job.ticket))
+            job.onError(job.ticket, *error ? error : "unknown error");
+    }
+};
+
+#endif // KNOWLEDGEBASE_H
@@ -0,0 +1,401 @@
+// Google Benchmark suite for the text, cipher and knowledge-base hot paths.
+// All data is synthetic and generated from fixed seeds, so runs are comparable
+// between releases. Build with benchmark.pro; for regression tracking run
+//   ./kbbenchmark --benchmark_out=results.json --benchmark_out_format=json
+// Large sizes take a while to build; narrow them with --benchmark_filter.
+
+#include "KnowledgeBase.h"
+
+#include <benchmark/benchmark.h>
+
+#include <map>
+#include <unordered_map>
+
+namespace {
+
+const std::string KEY = "k1eFjP@7xL9qZ#5mR2tY8sA3vB6nC0wD";
+constexpr int VOCABULARY = 5000;
+
+// -----------------------------
+// Synthetic Data
+// -----------------------------
+std::string randomSentence(std::mt19937 &gen, int words) {
+    std::string sentence;
+    for (int w = 0; w < words; ++w) {
+        if (w > 0)
+            sentence += ' ';
+        sentence += (gen() % 4 == 0) ? "What's" : "w";
+        sentence += std::to_string(gen() % VOCABULARY);
+        if (gen() % 8 == 0)
+            sentence += '?';
+    }
+    return sentence;
+}
+
+std::vector<std::pair<std::string, std::string>> syntheticEntries(size_t count) {
+    std::mt19937 gen(42);
+    std::vector<std::pair<std::string, std::string>> entries;
+    entries.reserve(count);
+    for (size_t i = 0; i < count; ++i)
+        entries.emplace_back(randomSentence(gen, 3 + static_cast<int>(gen() % 8)),
+                             "synthetic answer " + std::to_string(i));
+    return entries;
+}
+
+std::string syntheticJSON(size_t count) {
+    std::string json = "[";
+    for (const auto &entry : syntheticEntries(count)) {
+        if (json.size() > 1)
+            json += ",\n";
+        json += "{\"question\": \"" + entry.first + "\", \"answer\": \"" + entry.second + "\"}";
+    }
+    return json + "]";
+}
+
+std::string temporaryPath(const std::string &name) {
+    return (std::filesystem::temp_directory_path() / ("kbbenchmark_" + name)).string();
+}
+
+void removeKnowledgeBaseFiles(const std::string &path) {
+    std::error_code error;
+    for (const char *suffix : {"", ".journal", ".journal.sealed", ".tmp", ".snap", ".snap.tmp"})
+        std::filesystem::remove(path + suffix, error);
+}
+
+// Knowledge bases are expensive to build, so each size is built once, compacted
+// to a snapshot on disk (plus a mapped .snap) and shared by every benchmark
+// that needs it.
+struct KnowledgeBaseCache {
+    std::map<size_t, std::unique_ptr<KnowledgeBase>> entries;
+    
+    ~KnowledgeBaseCache() {
+        for (auto &cached : entries) {
+            cached.second.reset();
+            removeKnowledgeBaseFiles(pathFor(cached.first));
+        }
+    }
+    
+    static std::string pathFor(size_t entries) {
+        return temporaryPath(std::to_string(entries) + ".dat");
+    }
+};
+
+KnowledgeBase &knowledgeBase(size_t entries) {
+    static KnowledgeBaseCache cache;
+    auto &kb = cache.entries[entries];
+    if (!kb) {
+        std::string path = KnowledgeBaseCache::pathFor(entries);
+        removeKnowledgeBaseFiles(path);
+        kb = std::make_unique<KnowledgeBase>(path, KEY);
+        std::vector<std::pair<std::string_view, std::string_view>> batch;
+        auto data = syntheticEntries(entries);
+        for (size_t i = 0; i < data.size(); i += 4096) {
+            batch.clear();
+            for (size_t j = i; j < std::min(data.size(), i + 4096); ++j)
+                batch.emplace_back(data[j].first, data[j].second);
+            kb->addEntries(batch);
+        }
+        kb->setMappedSnapshot(path + ".snap");
+        kb->compact();
+        kb->setMappedSnapshot(std::string());
+    }
+    return *kb;
+}
+
+// -----------------------------
+// TextProcessor
+// -----------------------------
+void BM_NormalizeString(benchmark::State &state) {
+    std::mt19937 gen(1);
+    std::string text = randomSentence(gen, static_cast<int>(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(TextProcessor::normalizeString(text));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+}
+BENCHMARK(BM_NormalizeString)->RangeMultiplier(4)->Range(4, 256);
+
+void BM_Tokenize(benchmark::State &state) {
+    std::mt19937 gen(2);
+    std::string text = randomSentence(gen, static_cast<int>(state.range(0)));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(TextProcessor::tokenize(text));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(text.size()));
+}
+BENCHMARK(BM_Tokenize)->RangeMultiplier(4)->Range(4, 256);
+
+void BM_CalculateSimilarity(benchmark::State &state) {
+    std::mt19937 gen(3);
+    std::string a = TextProcessor::normalizeString(randomSentence(gen, static_cast<int>(state.range(0))));
+    std::string b = TextProcessor::normalizeString(randomSentence(gen, static_cast<int>(state.range(0))));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(TextProcessor::calculateSimilarity(a, b));
+}
+BENCHMARK(BM_CalculateSimilarity)->RangeMultiplier(4)->Range(4, 256);
+
+void BM_CalculateSimilarityTokenIds(benchmark::State &state) {
+    std::mt19937 gen(4);
+    std::vector<uint32_t> a(static_cast<size_t>(state.range(0))), b(a.size());
+    for (size_t i = 0; i < a.size(); ++i) {
+        a[i] = gen() % VOCABULARY;
+        b[i] = gen() % VOCABULARY;
+    }
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    for (auto _ : state)
+        benchmark::DoNotOptimize(TextProcessor::calculateSimilarity(a.data(), a.size(), b.data(), b.size()));
+}
+BENCHMARK(BM_CalculateSimilarityTokenIds)->RangeMultiplier(4)->Range(4, 256);
+
+// -----------------------------
+// Cryptography
+// -----------------------------
+void BM_Encrypt(benchmark::State &state) {
+    std::string data(static_cast<size_t>(state.range(0)), 'x');
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Cryptography::encrypt(data, KEY));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Encrypt)->RangeMultiplier(16)->Range(64, 16 << 20);
+
+// Baseline: the byte-at-a-time loop encrypt() replaced, kept here so the
+// keystream speedup stays measurable.
+std::string encryptByteLoop(const std::string &data, const std::string &key, const std::string &iv) {
+    std::string result = iv;
+    for (size_t i = 0; i < data.size(); ++i) {
+        char c = data[i] ^ key[i % key.size()] ^ iv[i % iv.size()];
+        result.push_back(c);
+    }
+    return result;
+}
+
+void BM_EncryptByteLoop(benchmark::State &state) {
+    std::string data(static_cast<size_t>(state.range(0)), 'x');
+    std::mt19937 gen(6);
+    std::string iv;
+    for (size_t i = 0; i < Cryptography::IV_SIZE; ++i)
+        iv.push_back(static_cast<char>(gen() % 256));
+    for (auto _ : state)
+        benchmark::DoNotOptimize(encryptByteLoop(data, KEY, iv));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_EncryptByteLoop)->RangeMultiplier(16)->Range(64, 16 << 20);
+
+void BM_Decrypt(benchmark::State &state) {
+    std::string encrypted = Cryptography::encrypt(std::string(static_cast<size_t>(state.range(0)), 'x'), KEY);
+    for (auto _ : state)
+        benchmark::DoNotOptimize(Cryptography::decrypt(encrypted, KEY));
+    state.SetBytesProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Decrypt)->RangeMultiplier(16)->Range(64, 16 << 20);
+
+// -----------------------------
+// KnowledgeBase
+// -----------------------------
+// Arguments: entries in the knowledge base. Each iteration opens a fresh
+// KnowledgeBase on the shared snapshot, so it measures a cold load.
+void BM_LoadFromFile(benchmark::State &state) {
+    const size_t entries = static_cast<size_t>(state.range(0));
+    knowledgeBase(entries);
+    for (auto _ : state) {
+        auto kb = std::make_unique<KnowledgeBase>(KnowledgeBaseCache::pathFor(entries), KEY);
+        benchmark::DoNotOptimize(kb->size());
+        state.PauseTiming();
+        kb.reset();
+        state.ResumeTiming();
+    }
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_LoadFromFile)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond);
+
+// Cold start from the mapped snapshot compaction writes next to the .dat file:
+// map it and answer one question.
+void BM_OpenSnapshot(benchmark::State &state) {
+    const size_t entries = static_cast<size_t>(state.range(0));
+    knowledgeBase(entries);
+    std::string question = syntheticEntries(1).front().first;
+    for (auto _ : state) {
+        MappedKnowledgeBase snapshot(KnowledgeBaseCache::pathFor(entries) + ".snap");
+        benchmark::DoNotOptimize(snapshot.findAnswer(question));
+    }
+}
+BENCHMARK(BM_OpenSnapshot)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMicrosecond);
+
+// Full snapshot rewrite, the cost saveToFile pays whenever it compacts.
+void BM_Compact(benchmark::State &state) {
+    KnowledgeBase &kb = knowledgeBase(static_cast<size_t>(state.range(0)));
+    for (auto _ : state)
+        kb.compact();
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+}
+BENCHMARK(BM_Compact)->RangeMultiplier(10)->Range(1000, 10000000)->Unit(benchmark::kMillisecond);
+
+// One journaled change followed by saveToFile, the per-edit cost in the app.
+void BM_AddEntryAndSave(benchmark::State &state) {
+    std::string path = temporaryPath("save.dat");
+    removeKnowledgeBaseFiles(path);
+    {
+        KnowledgeBase kb(path, KEY);
+        kb.setCompactionRatio(1e9);
+        size_t i = 0;
+        for (auto _ : state) {
+            kb.addEntry("benchmark question " + std::to_string(i), "answer " + std::to_string(i));
+            kb.saveToFile();
+            ++i;
+        }
+    }
+    removeKnowledgeBaseFiles(path);
+}
+BENCHMARK(BM_AddEntryAndSave);
+
+// Arguments: entries in the knowledge base, words per query. Queries are one
+// third stored questions of that length, one third the same questions with one
+// word changed and one third unrelated text.
+void BM_FindAnswer(benchmark::State &state) {
+    const size_t entries = static_cast<size_t>(state.range(0));
+    const int words = static_cast<int>(state.range(1));
+    KnowledgeBase &kb = knowledgeBase(entries);
+    std::vector<std::vector<std::string>> questions;
+    for (const auto &entry : syntheticEntries(std::min<size_t>(entries, 100000))) {
+        std::vector<std::string> question;
+        std::istringstream iss(entry.first);
+        for (std::string word; iss >> word;)
+            question.push_back(word);
+        if (static_cast<int>(question.size()) == words)
+            questions.push_back(std::move(question));
+    }
+    std::mt19937 gen(5);
+    std::vector<std::string> queries;
+    for (int i = 0; i < 300; ++i) {
+        std::string query;
+        if (i % 3 == 2 || questions.empty()) {
+            query = randomSentence(gen, words);
+        } else {
+            std::vector<std::string> question = questions[gen() % questions.size()];
+            if (i % 3 == 1)
+                question[gen() % question.size()] = "changed";
+            for (const std::string &word : question)
+                query += (query.empty() ? "" : " ") + word;
+        }
+        queries.push_back(query);
+    }
+    size_t hits = 0, i = 0;
+    for (auto _ : state) {
+        std::string answer = kb.findAnswer(queries[i++ % queries.size()]);
+        hits += !answer.empty();
+        benchmark::DoNotOptimize(answer);
+    }
+    state.counters["hit_rate"] = state.iterations() ? static_cast<double>(hits) / state.iterations() : 0.0;
+}
+BENCHMARK(BM_FindAnswer)->ArgsProduct({benchmark::CreateRange(1000, 10000000, 10), {3, 6, 10}});
+
+// -----------------------------
+// Entry Storage
+// -----------------------------
+// Heap bytes per entry of EntryStore against the unordered_map<string, string>
+// it replaced. The map's bytes, string buffers included, are counted by an
+// allocator. Arguments: entries. Each iteration builds one store.
+size_t countedBytes = 0;
+
+template <typename T>
+struct CountingAllocator {
+    using value_type = T;
+    
+    CountingAllocator() = default;
+    template <typename U>
+    CountingAllocator(const CountingAllocator<U> &) {}
+    
+    T *allocate(size_t n) {
+        countedBytes += n * sizeof(T);
+        return std::allocator<T>().allocate(n);
+    }
+    
+    void deallocate(T *p, size_t n) {
+        countedBytes -= n * sizeof(T);
+        std::allocator<T>().deallocate(p, n);
+    }
+    
+    template <typename U>
+    bool operator==(const CountingAllocator<U> &) const { return true; }
+    template <typename U>
+    bool operator!=(const CountingAllocator<U> &) const { return false; }
+};
+
+using CountedString = std::basic_string<char, std::char_traits<char>, CountingAllocator<char>>;
+
+struct CountedStringHash {
+    size_t operator()(const CountedString &text) const {
+        return std::hash<std::string_view>()(text);
+    }
+};
+
+void BM_EntryStoreMemory(benchmark::State &state) {
+    auto data = syntheticEntries(static_cast<size_t>(state.range(0)));
+    size_t bytes = 0, entries = 0;
+    for (auto _ : state) {
+        EntryStore store;
+        for (const auto &entry : data)
+            if (store.find(entry.first) == EntryStore::NOT_FOUND)
+                store.append(entry.first, entry.second);
+        bytes = store.memoryUsage();
+        entries = store.size();
+    }
+    state.counters["bytes_per_entry"] = entries ? static_cast<double>(bytes) / entries : 0.0;
+}
+BENCHMARK(BM_EntryStoreMemory)->RangeMultiplier(10)->Range(1000, 1000000)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+void BM_UnorderedMapMemory(benchmark::State &state) {
+    auto data = syntheticEntries(static_cast<size_t>(state.range(0)));
+    size_t bytes = 0, entries = 0;
+    for (auto _ : state) {
+        size_t baseline = countedBytes;
+        std::unordered_map<CountedString, CountedString, CountedStringHash, std::equal_to<CountedString>,
+                           CountingAllocator<std::pair<const CountedString, CountedString>>> map;
+        for (const auto &entry : data)
+            map.emplace(CountedString(entry.first.data(), entry.first.size()),
+                        CountedString(entry.second.data(), entry.second.size()));
+        bytes = countedBytes - baseline;
+        entries = map.size();
+    }
+    state.counters["bytes_per_entry"] = entries ? static_cast<double>(bytes) / entries : 0.0;
+}
+BENCHMARK(BM_UnorderedMapMemory)->RangeMultiplier(10)->Range(1000, 1000000)->Iterations(1)->Unit(benchmark::kMillisecond);
+
+// -----------------------------
+// Ingest
+// -----------------------------
+// Streaming JSON import into a fresh knowledge base, the path behind Load JSON
+// and /trainfile. Arguments: entries in the file.
+void BM_IngestJSON(benchmark::State &state) {
+    const std::string json = syntheticJSON(static_cast<size_t>(state.range(0)));
+    std::string path = temporaryPath("ingest.dat");
+    for (auto _ : state) {
+        state.PauseTiming();
+        removeKnowledgeBaseFiles(path);
+        auto kb = std::make_unique<KnowledgeBase>(path, KEY);
+        state.ResumeTiming();
+        JsonEntryReader reader;
+        IngestBatch batch;
+        auto onEntry = [&](std::string_view question, std::string_view answer) {
+            batch.add(question, answer);
+            if (batch.size() == 4096) {
+                kb->addEntries(batch.entries());
+                batch.clear();
+            }
+        };
+        for (size_t offset = 0; offset < json.size(); offset += Cryptography::BLOCK_SIZE)
+            reader.append(json.data() + offset, std::min(Cryptography::BLOCK_SIZE, json.size() - offset), onEntry);
+        reader.finish();
+        kb->addEntries(batch.entries());
+        state.PauseTiming();
+        kb.reset();
+        state.ResumeTiming();
+    }
+    removeKnowledgeBaseFiles(path);
+    state.SetItemsProcessed(state.iterations() * state.range(0));
+    state.SetBytesProcessed(state.iterations() * static_cast<int64_t>(json.size()));
+}
+BENCHMARK(BM_IngestJSON)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMillisecond);
+
+} // namespace
+
+BENCHMARK_MAIN();
@@ -0,0 +1,127 @@
+#ifndef MINHASHINDEX_H
+#define MINHASHINDEX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+// ===========================
+// MinHash / LSH Index
+// ===========================
+
+/**
+ * @brief Locality-sensitive index over sorted token-id arrays.
+ *
+ * Each entry gets bands * rows MinHash values; every band of `rows` values is
+ * hashed into its own bucket table. Entries sharing at least one bucket with a
+ * query become candidates, so lookup cost depends on bucket sizes rather than
+ * on the number of entries. Probability of becoming a candidate at Jaccard s is
+ * 1 - (1 - s^rows)^bands. Repeated tokens are hashed as (token, occurrence)
+ * pairs so the estimate matches the multiset Jaccard used for exact scoring.
+ */
+class MinHashIndex {
+public:
+    /**
+     * @param bands Number of bucket tables.
+     * @param rows MinHash values combined into each band key.
+     * @param maxCandidates Candidates returned per query, ranked by shared bands.
+     */
+    MinHashIndex(uint32_t bands, uint32_t rows, size_t maxCandidates)
+        : m_bands(bands), m_rows(rows), m_maxCandidates(maxCandidates), m_buckets(bands) {
+        if (bands == 0 || rows == 0 || maxCandidates == 0)
+            throw std::invalid_argument("MinHashIndex needs at least one band, row and candidate");
+        m_seeds.reserve(static_cast<size_t>(bands) * rows);
+        uint64_t state = 0x243F6A8885A308D3ULL;
+        for (size_t i = 0; i < static_cast<size_t>(bands) * rows; ++i)
+            m_seeds.push_back(mix(state += 0x9E3779B97F4A7C15ULL));
+    }
+
+    void addEntry(uint32_t entryId, const uint32_t *tokens, size_t length) {
+        if (length == 0)
+            return;
+        std::vector<uint64_t> keys = bandKeys(tokens, length);
+        for (uint32_t band = 0; band < m_bands; ++band)
+            m_buckets[band][keys[band]].push_back(entryId);
+    }
+
+    /**
+     * @brief Returns up to maxCandidates entry ids, in ascending order, that
+     * share a band with the query. Entries sharing more bands are kept first.
+     */
+    std::vector<uint32_t> candidates(const uint32_t *tokens, size_t length) const {
+        std::vector<uint32_t> result;
+        if (length == 0)
+            return result;
+        std::vector<uint64_t> keys = bandKeys(tokens, length);
+        std::unordered_map<uint32_t, uint32_t> sharedBands;
+        for (uint32_t band = 0; band < m_bands; ++band) {
+            auto it = m_buckets[band].find(keys[band]);
+            if (it == m_buckets[band].end())
+                continue;
+            for (uint32_t entryId : it->second)
+                ++sharedBands[entryId];
+        }
+        std::vector<std::pair<uint32_t, uint32_t>> ranked(sharedBands.begin(), sharedBands.end());
+        if (ranked.size() > m_maxCandidates) {
+            std::nth_element(ranked.begin(), ranked.begin() + m_maxCandidates, ranked.end(),
+                             [](const auto &a, const auto &b) {
+                                 return a.second != b.second ? a.second > b.second : a.first < b.first;
+                             });
+            ranked.resize(m_maxCandidates);
+        }
+        result.reserve(ranked.size());
+        for (const auto &candidate : ranked)
+            result.push_back(candidate.first);
+        std::sort(result.begin(), result.end());
+        return result;
+    }
+
+    void clear() {
+        for (auto &table : m_buckets)
+            table.clear();
+    }
+
+    uint32_t bands() const { return m_bands; }
+    uint32_t rows() const { return m_rows; }
+
+private:
+    uint32_t m_bands;
+    uint32_t m_rows;
+    size_t m_maxCandidates;
+    std::vector<uint64_t> m_seeds;
+    std::vector<std::unordered_map<uint64_t, std::vector<uint32_t>>> m_buckets;
+
+    static uint64_t mix(uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xBF58476D1CE4E5B9ULL;
+        x ^= x >> 27;
+        x *= 0x94D049BB133111EBULL;
+        x ^= x >> 31;
+        return x;
+    }
+
+    std::vector<uint64_t> bandKeys(const uint32_t *tokens, size_t length) const {
+        std::vector<uint64_t> signature(m_seeds.size(), std::numeric_limits<uint64_t>::max());
+        uint32_t occurrence = 0;
+        for (size_t i = 0; i < length; ++i) {
+            occurrence = (i > 0 && tokens[i] == tokens[i - 1]) ? occurrence + 1 : 0;
+            uint64_t element = mix((static_cast<uint64_t>(tokens[i]) << 32) | occurrence);
+            for (size_t h = 0; h < m_seeds.size(); ++h)
+                signature[h] = std::min(signature[h], mix(element ^ m_seeds[h]));
+        }
+        std::vector<uint64_t> keys(m_bands);
+        for (uint32_t band = 0; band < m_bands; ++band) {
+            uint64_t key = band;
+            for (uint32_t row = 0; row < m_rows; ++row)
+                key = mix(key ^ signature[static_cast<size_t>(band) * m_rows + row]);
+            keys[band] = key;
+        }
+        return keys;
+    }
+};
+
+#endif // MINHASHINDEX_H
@@ -0,0 +1,96 @@
+#ifndef MPSCRING_H
+#define MPSCRING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+// ===========================
+// Bounded MPSC Ring
+// ===========================
+
+/**
+ * @brief Bounded lock-free ring for many producers and one consumer.
+ *
+ * Vyukov's bounded queue: each slot's sequence number says whether it is free
+ * for the producer at that position or filled for the consumer. Producers
+ * claim a position with one CAS and never allocate; tryConsume() and
+ * hasQueued() may only be called from the single consumer thread. The ring
+ * only moves values; how the consumer is woken is up to its owner.
+ */
+template <typename T>
+class MpscRing {
+    static_assert(std::is_nothrow_move_assignable<T>::value,
+                  "a claimed slot must be filled without throwing");
+
+public:
+    /// @param capacity Slots, rounded up to a power of two (at least 2).
+    explicit MpscRing(size_t capacity) {
+        size_t slots = 2;
+        while (slots < capacity)
+            slots <<= 1;
+        m_mask = slots - 1;
+        m_slots.reset(new Slot[slots]);
+        for (size_t i = 0; i < slots; ++i)
+            m_slots[i].sequence.store(i, std::memory_order_relaxed);
+    }
+
+    MpscRing(const MpscRing &) = delete;
+    MpscRing &operator=(const MpscRing &) = delete;
+
+    /// Moves `value` into a free slot; returns false, leaving it untouched,
+    /// if the ring is full.
+    bool tryPush(T &value) {
+        size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot &slot = m_slots[pos & m_mask];
+            size_t sequence = slot.sequence.load(std::memory_order_acquire);
+            intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+            if (diff == 0) {
+                if (m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.value = std::move(value);
+                    slot.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = m_enqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /// Consumer only: whether the oldest slot holds a value.
+    bool hasQueued() const {
+        return m_slots[m_dequeuePos & m_mask].sequence.load(std::memory_order_acquire) == m_dequeuePos + 1;
+    }
+
+    /// Consumer only: calls visit(T&) on the oldest value, then frees its
+    /// slot. Returns false if the ring is empty.
+    template <typename Visit>
+    bool tryConsume(Visit &&visit) {
+        if (!hasQueued())
+            return false;
+        Slot &slot = m_slots[m_dequeuePos & m_mask];
+        visit(slot.value);
+        slot.sequence.store(m_dequeuePos + m_mask + 1, std::memory_order_release);
+        ++m_dequeuePos;
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<size_t> sequence;
+        T value;
+    };
+
+    std::unique_ptr<Slot[]> m_slots;
+    size_t m_mask = 0;
+    alignas(64) std::atomic<size_t> m_enqueuePos{0};
+    alignas(64) size_t m_dequeuePos = 0;              // Consumer thread only
+};
+
+#endif // MPSCRING_H
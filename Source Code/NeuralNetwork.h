@@ -0,0 +1,789 @@
+#ifndef NEURALNETWORK_H
+#define NEURALNETWORK_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <new>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define NN_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define NN_TARGET_AVX2
+#else
+#define NN_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#endif
+#endif
+
+// ===========================
+// Aligned Buffer
+// ===========================
+
+/**
+ * @brief Zero-initialized, 64-byte aligned array for weights and activations.
+ *
+ * Rows stored in it are padded to DenseKernels::LANES floats, so every row
+ * starts on a SIMD boundary.
+ */
+template <typename T>
+class AlignedBuffer {
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    AlignedBuffer() = default;
+    explicit AlignedBuffer(size_t count) { resize(count); }
+    ~AlignedBuffer() { release(); }
+
+    AlignedBuffer(const AlignedBuffer& other) : AlignedBuffer(other.size_) {
+        std::copy(other.data_, other.data_ + size_, data_);
+    }
+
+    AlignedBuffer(AlignedBuffer&& other) noexcept : data_(other.data_), size_(other.size_) {
+        other.data_ = nullptr;
+        other.size_ = 0;
+    }
+
+    AlignedBuffer& operator=(AlignedBuffer other) noexcept {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    /// Resizes to `count` zeroed elements; the previous contents are discarded.
+    void resize(size_t count) {
+        release();
+        if (count == 0)
+            return;
+        data_ = static_cast<T*>(::operator new(count * sizeof(T), std::align_val_t(ALIGNMENT)));
+        std::fill(data_, data_ + count, T());
+        size_ = count;
+    }
+
+    /// Grows to at least `count` elements, keeping the buffer when it is large enough.
+    void reserve(size_t count) {
+        if (count > size_)
+            resize(count);
+    }
+
+    T* data() { return data_; }
+    const T* data() const { return data_; }
+    size_t size() const { return size_; }
+    T& operator[](size_t index) { return data_[index]; }
+    const T& operator[](size_t index) const { return data_[index]; }
+
+private:
+    T* data_ = nullptr;
+    size_t size_ = 0;
+
+    void release() {
+        if (data_)
+            ::operator delete(data_, std::align_val_t(ALIGNMENT));
+        data_ = nullptr;
+        size_ = 0;
+    }
+};
+
+// ===========================
+// Dense Kernels
+// ===========================
+
+enum class Activation : uint32_t {
+    Identity = 0,
+    ReLU = 1,
+    Sigmoid = 2,
+    Tanh = 3
+};
+
+/**
+ * @brief Cache-blocked dense layer kernels.
+ *
+ * denseForward computes C = activation(A * B^T + bias): A holds one sample per
+ * row, B one output neuron's weights per row, so both operands are read
+ * contiguously along k. The work is tiled so a block of A and B stays in cache
+ * while a register-blocked micro-kernel computes a few rows by a few columns
+ * of C. Bias and activation are applied to each tile right after its last k
+ * block, while it is still in cache. The AVX2/FMA micro-kernels are picked at
+ * run time when the CPU supports them; otherwise the scalar ones run.
+ */
+class DenseKernels {
+public:
+    static constexpr size_t LANES = 8;   ///< Floats per AVX2 register; strides are multiples of it.
+
+    static size_t paddedStride(size_t count) { return (count + LANES - 1) / LANES * LANES; }
+
+    static bool avx2Supported() {
+#if defined(NN_X86) && defined(_MSC_VER) && !defined(__clang__)
+        static const bool supported = [] {
+            int info[4];
+            __cpuid(info, 1);
+            bool fma = (info[2] & (1 << 12)) != 0;
+            bool osxsave = (info[2] & (1 << 27)) != 0;
+            bool avx = (info[2] & (1 << 28)) != 0;
+            if (!fma || !osxsave || !avx || (_xgetbv(0) & 6) != 6)
+                return false;
+            __cpuidex(info, 7, 0);
+            return (info[1] & (1 << 5)) != 0;
+        }();
+        return supported;
+#elif defined(NN_X86)
+        static const bool supported = __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        return supported;
+#else
+        return false;
+#endif
+    }
+
+    /// Forces the scalar kernels, e.g. to compare them against AVX2.
+    static void setScalarOnly(bool scalarOnly) { scalarOnlyFlag() = scalarOnly; }
+    static bool usingAvx2() { return !scalarOnlyFlag() && avx2Supported(); }
+
+    /**
+     * @brief C[m x n] = activation(A[m x k] * B[n x k]^T + bias[n]).
+     *
+     * k must be a positive multiple of LANES, with A and B zero beyond the
+     * real inputs. Columns n..ldc of C are zeroed so C can feed the next
+     * layer directly.
+     */
+    static void denseForward(const float* a, size_t lda, size_t m,
+                             const float* b, size_t ldb, size_t n, size_t k,
+                             const float* bias, Activation activation,
+                             float* c, size_t ldc) {
+        const bool avx2 = usingAvx2();
+        const size_t nr = m >= MR ? NR_BATCH : NR_SINGLE;
+        for (size_t m0 = 0; m0 < m; m0 += MB) {
+            const size_t mEnd = std::min(m, m0 + MB);
+            for (size_t n0 = 0; n0 < n; n0 += NB) {
+                const size_t nEnd = std::min(n, n0 + NB);
+                for (size_t k0 = 0; k0 < k; k0 += KB) {
+                    const size_t kEnd = std::min(k, k0 + KB);
+                    for (size_t i = m0; i < mEnd; i += MR) {
+                        const size_t rows = std::min(MR, mEnd - i);
+                        for (size_t j = n0; j < nEnd; j += nr) {
+                            const size_t cols = std::min(nr, nEnd - j);
+                            float partial[MR * NR_SINGLE];
+                            microKernel(avx2, rows, cols)(a + i * lda, lda, b + j * ldb, ldb, k0, kEnd, partial);
+                            for (size_t r = 0; r < rows; ++r) {
+                                float* out = c + (i + r) * ldc + j;
+                                for (size_t col = 0; col < cols; ++col)
+                                    out[col] = (k0 == 0 ? 0.0f : out[col]) + partial[r * cols + col];
+                            }
+                        }
+                    }
+                }
+                for (size_t i = m0; i < mEnd; ++i)
+                    biasActivation(c + i * ldc + n0, nEnd - n0, bias ? bias + n0 : nullptr, activation);
+            }
+        }
+        for (size_t i = 0; i < m; ++i)
+            std::fill(c + i * ldc + n, c + i * ldc + ldc, 0.0f);
+    }
+
+    /// y[i] += alpha * x[i]; count must be a multiple of LANES.
+    static void axpy(float alpha, const float* x, float* y, size_t count) {
+#ifdef NN_X86
+        if (usingAvx2()) {
+            axpyAvx2(alpha, x, y, count);
+            return;
+        }
+#endif
+        for (size_t i = 0; i < count; ++i)
+            y[i] += alpha * x[i];
+    }
+
+    /// gradients[i] *= activation'(x) where values[i] = activation(x).
+    static void activationGradient(const float* values, float* gradients, size_t count, Activation activation) {
+        switch (activation) {
+        case Activation::Identity:
+            break;
+        case Activation::ReLU:
+            for (size_t i = 0; i < count; ++i)
+                gradients[i] = values[i] > 0.0f ? gradients[i] : 0.0f;
+            break;
+        case Activation::Sigmoid:
+            for (size_t i = 0; i < count; ++i)
+                gradients[i] *= values[i] * (1.0f - values[i]);
+            break;
+        case Activation::Tanh:
+            for (size_t i = 0; i < count; ++i)
+                gradients[i] *= 1.0f - values[i] * values[i];
+            break;
+        }
+    }
+
+    /// values[i] = activation(values[i] + bias[i]); bias may be null.
+    static void biasActivation(float* values, size_t count, const float* bias, Activation activation) {
+        if (bias)
+            for (size_t i = 0; i < count; ++i)
+                values[i] += bias[i];
+        switch (activation) {
+        case Activation::Identity:
+            break;
+        case Activation::ReLU:
+            for (size_t i = 0; i < count; ++i)
+                values[i] = std::max(values[i], 0.0f);
+            break;
+        case Activation::Sigmoid:
+            for (size_t i = 0; i < count; ++i)
+                values[i] = 1.0f / (1.0f + std::exp(-values[i]));
+            break;
+        case Activation::Tanh:
+            for (size_t i = 0; i < count; ++i)
+                values[i] = std::tanh(values[i]);
+            break;
+        }
+    }
+
+private:
+    // Tile sizes: a KB-float slice of MR rows of A plus NR rows of B stays in
+    // L1, and an MB x KB block of A plus an NB x KB block of B in L2.
+    static constexpr size_t MR = 4;
+    static constexpr size_t NR_BATCH = 3;    ///< 4 x 3 accumulators for batches
+    static constexpr size_t NR_SINGLE = 4;   ///< 1 x 4 for single samples
+    static constexpr size_t MB = 64;
+    static constexpr size_t NB = 48;
+    static constexpr size_t KB = 512;
+
+    using MicroKernel = void (*)(const float* a, size_t lda, const float* b, size_t ldb,
+                                 size_t kBegin, size_t kEnd, float* partial);
+
+    static bool& scalarOnlyFlag() {
+        static bool scalarOnly = false;
+        return scalarOnly;
+    }
+
+    // partial[r * NR + c] = dot(A row r, B row c) over [kBegin, kEnd).
+    template <int ROWS, int COLS>
+    static void microScalar(const float* a, size_t lda, const float* b, size_t ldb,
+                            size_t kBegin, size_t kEnd, float* partial) {
+        float acc[ROWS][COLS] = {};
+        for (size_t k = kBegin; k < kEnd; ++k)
+            for (int r = 0; r < ROWS; ++r)
+                for (int c = 0; c < COLS; ++c)
+                    acc[r][c] += a[r * lda + k] * b[c * ldb + k];
+        for (int r = 0; r < ROWS; ++r)
+            for (int c = 0; c < COLS; ++c)
+                partial[r * COLS + c] = acc[r][c];
+    }
+
+#ifdef NN_X86
+    static NN_TARGET_AVX2 float horizontalSum(__m256 v) {
+        __m128 sum = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+        __m128 shuffled = _mm_movehdup_ps(sum);
+        sum = _mm_add_ps(sum, shuffled);
+        shuffled = _mm_movehl_ps(shuffled, sum);
+        return _mm_cvtss_f32(_mm_add_ss(sum, shuffled));
+    }
+
+    template <int ROWS, int COLS>
+    static NN_TARGET_AVX2 void microAvx2(const float* a, size_t lda, const float* b, size_t ldb,
+                                         size_t kBegin, size_t kEnd, float* partial) {
+        __m256 acc[ROWS][COLS];
+        for (int r = 0; r < ROWS; ++r)
+            for (int c = 0; c < COLS; ++c)
+                acc[r][c] = _mm256_setzero_ps();
+        for (size_t k = kBegin; k < kEnd; k += LANES) {
+            __m256 weights[COLS];
+            for (int c = 0; c < COLS; ++c)
+                weights[c] = _mm256_loadu_ps(b + c * ldb + k);
+            for (int r = 0; r < ROWS; ++r) {
+                __m256 input = _mm256_loadu_ps(a + r * lda + k);
+                for (int c = 0; c < COLS; ++c)
+                    acc[r][c] = _mm256_fmadd_ps(input, weights[c], acc[r][c]);
+            }
+        }
+        for (int r = 0; r < ROWS; ++r)
+            for (int c = 0; c < COLS; ++c)
+                partial[r * COLS + c] = horizontalSum(acc[r][c]);
+    }
+
+    static NN_TARGET_AVX2 void axpyAvx2(float alpha, const float* x, float* y, size_t count) {
+        const __m256 scale = _mm256_set1_ps(alpha);
+        for (size_t i = 0; i < count; i += LANES)
+            _mm256_storeu_ps(y + i, _mm256_fmadd_ps(scale, _mm256_loadu_ps(x + i), _mm256_loadu_ps(y + i)));
+    }
+#endif
+
+    static MicroKernel microKernel(bool avx2, size_t rows, size_t cols) {
+        static const MicroKernel scalar[MR][NR_SINGLE] = {
+            {microScalar<1, 1>, microScalar<1, 2>, microScalar<1, 3>, microScalar<1, 4>},
+            {microScalar<2, 1>, microScalar<2, 2>, microScalar<2, 3>, microScalar<2, 4>},
+            {microScalar<3, 1>, microScalar<3, 2>, microScalar<3, 3>, microScalar<3, 4>},
+            {microScalar<4, 1>, microScalar<4, 2>, microScalar<4, 3>, microScalar<4, 4>}};
+#ifdef NN_X86
+        static const MicroKernel simd[MR][NR_SINGLE] = {
+            {microAvx2<1, 1>, microAvx2<1, 2>, microAvx2<1, 3>, microAvx2<1, 4>},
+            {microAvx2<2, 1>, microAvx2<2, 2>, microAvx2<2, 3>, microAvx2<2, 4>},
+            {microAvx2<3, 1>, microAvx2<3, 2>, microAvx2<3, 3>, microAvx2<3, 4>},
+            {microAvx2<4, 1>, microAvx2<4, 2>, microAvx2<4, 3>, microAvx2<4, 4>}};
+        if (avx2)
+            return simd[rows - 1][cols - 1];
+#else
+        (void)avx2;
+#endif
+        return scalar[rows - 1][cols - 1];
+    }
+};
+
+// ===========================
+// Optimizer Kernels
+// ===========================
+
+/**
+ * @brief Parameter update rules, each fused into a single pass over memory.
+ *
+ * Every kernel reads and writes the parameter, gradient and state arrays once
+ * per step, eight floats at a time with AVX2/FMA when DenseKernels uses it.
+ * Counts need not be a multiple of LANES.
+ */
+class OptimizerKernels {
+public:
+    /// p -= rate * g
+    static void sgd(float* parameters, const float* gradients, size_t count, float rate) {
+        size_t i = 0;
+#ifdef NN_X86
+        if (DenseKernels::usingAvx2())
+            i = sgdAvx2(parameters, gradients, count, rate);
+#endif
+        for (; i < count; ++i)
+            parameters[i] -= rate * gradients[i];
+    }
+
+    /// v = momentum * v + g; p -= rate * v
+    static void momentum(float* parameters, const float* gradients, float* velocity, size_t count,
+                         float rate, float momentum) {
+        size_t i = 0;
+#ifdef NN_X86
+        if (DenseKernels::usingAvx2())
+            i = momentumAvx2(parameters, gradients, velocity, count, rate, momentum);
+#endif
+        for (; i < count; ++i) {
+            velocity[i] = momentum * velocity[i] + gradients[i];
+            parameters[i] -= rate * velocity[i];
+        }
+    }
+
+    /**
+     * @brief m = beta1 * m + (1 - beta1) * g; v = beta2 * v + (1 - beta2) * g^2;
+     * p -= stepSize * m / (sqrt(v) + epsilon).
+     *
+     * stepSize carries the bias correction, so the moments need no second pass.
+     */
+    static void adam(float* parameters, const float* gradients, float* mean, float* variance, size_t count,
+                     float stepSize, float beta1, float beta2, float epsilon) {
+        size_t i = 0;
+#ifdef NN_X86
+        if (DenseKernels::usingAvx2())
+            i = adamAvx2(parameters, gradients, mean, variance, count, stepSize, beta1, beta2, epsilon);
+#endif
+        for (; i < count; ++i) {
+            float g = gradients[i];
+            mean[i] = beta1 * mean[i] + (1.0f - beta1) * g;
+            variance[i] = beta2 * variance[i] + (1.0f - beta2) * g * g;
+            parameters[i] -= stepSize * mean[i] / (std::sqrt(variance[i]) + epsilon);
+        }
+    }
+
+private:
+    static constexpr size_t LANES = DenseKernels::LANES;
+
+#ifdef NN_X86
+    // Each returns how many leading elements it updated.
+    static NN_TARGET_AVX2 size_t sgdAvx2(float* parameters, const float* gradients, size_t count, float rate) {
+        const __m256 r = _mm256_set1_ps(rate);
+        size_t i = 0;
+        for (; i + LANES <= count; i += LANES)
+            _mm256_storeu_ps(parameters + i,
+                             _mm256_fnmadd_ps(r, _mm256_loadu_ps(gradients + i), _mm256_loadu_ps(parameters + i)));
+        return i;
+    }
+
+    static NN_TARGET_AVX2 size_t momentumAvx2(float* parameters, const float* gradients, float* velocity,
+                                              size_t count, float rate, float momentum) {
+        const __m256 r = _mm256_set1_ps(rate);
+        const __m256 mu = _mm256_set1_ps(momentum);
+        size_t i = 0;
+        for (; i + LANES <= count; i += LANES) {
+            __m256 v = _mm256_fmadd_ps(mu, _mm256_loadu_ps(velocity + i), _mm256_loadu_ps(gradients + i));
+            _mm256_storeu_ps(velocity + i, v);
+            _mm256_storeu_ps(parameters + i, _mm256_fnmadd_ps(r, v, _mm256_loadu_ps(parameters + i)));
+        }
+        return i;
+    }
+
+    static NN_TARGET_AVX2 size_t adamAvx2(float* parameters, const float* gradients, float* mean, float* variance,
+                                          size_t count, float stepSize, float beta1, float beta2, float epsilon) {
+        const __m256 step = _mm256_set1_ps(stepSize);
+        const __m256 b1 = _mm256_set1_ps(beta1), c1 = _mm256_set1_ps(1.0f - beta1);
+        const __m256 b2 = _mm256_set1_ps(beta2), c2 = _mm256_set1_ps(1.0f - beta2);
+        const __m256 eps = _mm256_set1_ps(epsilon);
+        size_t i = 0;
+        for (; i + LANES <= count; i += LANES) {
+            __m256 g = _mm256_loadu_ps(gradients + i);
+            __m256 m = _mm256_fmadd_ps(b1, _mm256_loadu_ps(mean + i), _mm256_mul_ps(c1, g));
+            __m256 v = _mm256_fmadd_ps(b2, _mm256_loadu_ps(variance + i), _mm256_mul_ps(c2, _mm256_mul_ps(g, g)));
+            _mm256_storeu_ps(mean + i, m);
+            _mm256_storeu_ps(variance + i, v);
+            __m256 update = _mm256_div_ps(m, _mm256_add_ps(_mm256_sqrt_ps(v), eps));
+            _mm256_storeu_ps(parameters + i, _mm256_fnmadd_ps(step, update, _mm256_loadu_ps(parameters + i)));
+        }
+        return i;
+    }
+#endif
+};
+
+// ===========================
+// Feed-Forward Network
+// ===========================
+
+/// Training objective. Cross-entropy applies a softmax to the last layer's outputs.
+enum class Loss : uint32_t {
+    MeanSquaredError = 0,
+    SoftmaxCrossEntropy = 1
+};
+
+/**
+ * @brief Multi-layer perceptron evaluated with DenseKernels.
+ *
+ * All parameters live in one aligned buffer: per layer its weights, one row
+ * per output neuron padded with zeros to a multiple of LANES, then its bias
+ * padded the same way. Gradients use the same layout, so an optimizer can
+ * update the whole network in one pass over two arrays.
+ * forward() and backpropagate() are const and use only the caller's
+ * workspace, so one network can serve several threads that each bring their
+ * own.
+ */
+class FeedForwardNetwork {
+public:
+    struct Layer {
+        size_t inputs = 0;
+        size_t outputs = 0;
+        size_t stride = 0;                 ///< Padded inputs; row stride of weights.
+        Activation activation = Activation::Identity;
+        size_t offset = 0;                 ///< Start of the weights in parameters().
+        float* weights = nullptr;          ///< outputs x stride, row-major.
+        float* bias = nullptr;             ///< outputs
+
+        float& weight(size_t output, size_t input) { return weights[output * stride + input]; }
+        float weight(size_t output, size_t input) const { return weights[output * stride + input]; }
+    };
+
+    /// Ping-pong activation buffers, grown on demand and reused across calls.
+    struct Workspace {
+        AlignedBuffer<float> current;
+        AlignedBuffer<float> next;
+    };
+
+    /// Every layer's activations plus the error terms of the backward pass.
+    struct TrainingWorkspace {
+        std::vector<AlignedBuffer<float>> activations;   ///< Input, then each layer's output.
+        AlignedBuffer<float> delta;
+        AlignedBuffer<float> previousDelta;
+    };
+
+    FeedForwardNetwork() = default;
+
+    FeedForwardNetwork(const FeedForwardNetwork& other) : parameters_(other.parameters_), layers_(other.layers_) {
+        bindLayers();
+    }
+
+    FeedForwardNetwork(FeedForwardNetwork&& other) noexcept = default;
+
+    FeedForwardNetwork& operator=(FeedForwardNetwork other) noexcept {
+        std::swap(parameters_, other.parameters_);
+        std::swap(layers_, other.layers_);
+        return *this;
+    }
+
+    /**
+     * @param layerSizes Input size followed by each layer's output size.
+     * @param hidden Activation of every layer but the last.
+     * @param output Activation of the last layer.
+     */
+    FeedForwardNetwork(const std::vector<size_t>& layerSizes, Activation hidden, Activation output) {
+        if (layerSizes.size() < 2)
+            throw std::invalid_argument("A network needs an input size and at least one layer");
+        for (size_t i = 1; i < layerSizes.size(); ++i)
+            addLayer(layerSizes[i - 1], layerSizes[i], i + 1 == layerSizes.size() ? output : hidden);
+    }
+
+    void addLayer(size_t inputs, size_t outputs, Activation activation) {
+        if (inputs == 0 || outputs == 0)
+            throw std::invalid_argument("Layer sizes must be positive");
+        if (!layers_.empty() && layers_.back().outputs != inputs)
+            throw std::invalid_argument("Layer inputs do not match the previous layer's outputs");
+        Layer layer;
+        layer.inputs = inputs;
+        layer.outputs = outputs;
+        layer.stride = DenseKernels::paddedStride(inputs);
+        layer.activation = activation;
+        layer.offset = parameters_.size();
+        AlignedBuffer<float> grown(layer.offset + outputs * layer.stride + DenseKernels::paddedStride(outputs));
+        std::copy(parameters_.data(), parameters_.data() + parameters_.size(), grown.data());
+        parameters_ = std::move(grown);
+        layers_.push_back(layer);
+        bindLayers();
+    }
+
+    /// He initialization for ReLU layers, Xavier for the others; biases start at zero.
+    void initializeWeights(uint64_t seed) {
+        std::mt19937_64 gen(seed);
+        for (Layer& layer : layers_) {
+            double scale = layer.activation == Activation::ReLU
+                ? std::sqrt(2.0 / layer.inputs)
+                : std::sqrt(2.0 / (layer.inputs + layer.outputs));
+            std::normal_distribution<float> dist(0.0f, static_cast<float>(scale));
+            for (size_t o = 0; o < layer.outputs; ++o)
+                for (size_t i = 0; i < layer.inputs; ++i)
+                    layer.weight(o, i) = dist(gen);
+            std::fill(layer.bias, layer.bias + layer.outputs, 0.0f);
+        }
+    }
+
+    size_t inputSize() const { return layers_.empty() ? 0 : layers_.front().inputs; }
+    size_t outputSize() const { return layers_.empty() ? 0 : layers_.back().outputs; }
+    size_t layerCount() const { return layers_.size(); }
+    Layer& layer(size_t index) { return layers_[index]; }
+    const Layer& layer(size_t index) const { return layers_[index]; }
+    float* parameters() { return parameters_.data(); }
+    const float* parameters() const { return parameters_.data(); }
+    size_t parameterCount() const { return parameters_.size(); }
+
+    /**
+     * @brief Evaluates `count` samples.
+     * @param inputs count x inputSize() floats, one sample per row.
+     * @param outputs Receives count x outputSize() floats.
+     */
+    void forward(const float* inputs, size_t count, float* outputs, Workspace& workspace) const {
+        if (layers_.empty())
+            throw std::logic_error("Network has no layers");
+        size_t widest = 0;
+        for (const Layer& layer : layers_)
+            widest = std::max({widest, layer.stride, DenseKernels::paddedStride(layer.outputs)});
+        workspace.current.reserve(count * widest);
+        workspace.next.reserve(count * widest);
+        float* current = workspace.current.data();
+        float* next = workspace.next.data();
+
+        const Layer& first = layers_.front();
+        for (size_t s = 0; s < count; ++s) {
+            std::copy(inputs + s * first.inputs, inputs + (s + 1) * first.inputs, current + s * first.stride);
+            std::fill(current + s * first.stride + first.inputs, current + (s + 1) * first.stride, 0.0f);
+        }
+        for (const Layer& layer : layers_) {
+            size_t outputStride = DenseKernels::paddedStride(layer.outputs);
+            DenseKernels::denseForward(current, layer.stride, count, layer.weights, layer.stride,
+                                       layer.outputs, layer.stride, layer.bias, layer.activation,
+                                       next, outputStride);
+            std::swap(current, next);
+        }
+        const Layer& last = layers_.back();
+        size_t lastStride = DenseKernels::paddedStride(last.outputs);
+        for (size_t s = 0; s < count; ++s)
+            std::copy(current + s * lastStride, current + s * lastStride + last.outputs, outputs + s * last.outputs);
+    }
+
+    /**
+     * @brief Adds the loss gradient of `count` samples to `gradients`.
+     *
+     * Runs a forward pass that keeps every layer's activations, then
+     * propagates the error back through the layers. Gradients are summed over
+     * the samples in order, so equal inputs always give equal results.
+     * @param inputs count x inputSize() floats, one sample per row.
+     * @param targets count x outputSize() values for MeanSquaredError, count
+     *        class indices for SoftmaxCrossEntropy.
+     * @param gradients parameterCount() floats laid out like parameters();
+     *        added to, not overwritten.
+     * @return The summed loss of the samples.
+     */
+    double backpropagate(const float* inputs, const float* targets, size_t count, Loss loss,
+                         float* gradients, TrainingWorkspace& workspace) const {
+        if (layers_.empty())
+            throw std::logic_error("Network has no layers");
+        size_t widest = 0;
+        for (const Layer& layer : layers_)
+            widest = std::max({widest, layer.stride, DenseKernels::paddedStride(layer.outputs)});
+        workspace.activations.resize(layers_.size() + 1);
+        workspace.delta.reserve(count * widest);
+        workspace.previousDelta.reserve(count * widest);
+
+        const Layer& first = layers_.front();
+        workspace.activations[0].reserve(count * first.stride);
+        float* input = workspace.activations[0].data();
+        for (size_t s = 0; s < count; ++s) {
+            std::copy(inputs + s * first.inputs, inputs + (s + 1) * first.inputs, input + s * first.stride);
+            std::fill(input + s * first.stride + first.inputs, input + (s + 1) * first.stride, 0.0f);
+        }
+        for (size_t l = 0; l < layers_.size(); ++l) {
+            const Layer& layer = layers_[l];
+            size_t outputStride = DenseKernels::paddedStride(layer.outputs);
+            workspace.activations[l + 1].reserve(count * outputStride);
+            DenseKernels::denseForward(workspace.activations[l].data(), layer.stride, count, layer.weights,
+                                       layer.stride, layer.outputs, layer.stride, layer.bias, layer.activation,
+                                       workspace.activations[l + 1].data(), outputStride);
+        }
+
+        const Layer& last = layers_.back();
+        size_t deltaStride = DenseKernels::paddedStride(last.outputs);
+        float* delta = workspace.delta.data();
+        float* previousDelta = workspace.previousDelta.data();
+        double total = lossGradient(workspace.activations.back().data(), deltaStride, targets, count, loss, delta);
+
+        for (size_t l = layers_.size(); l-- > 0;) {
+            const Layer& layer = layers_[l];
+            const float* previous = workspace.activations[l].data();
+            float* weightGradients = gradients + layer.offset;
+            float* biasGradients = weightGradients + layer.outputs * layer.stride;
+            const bool propagate = l > 0;
+            if (propagate)
+                std::fill(previousDelta, previousDelta + count * layer.stride, 0.0f);
+            // One neuron at a time, so its weight and gradient rows stay in cache across the samples.
+            for (size_t o = 0; o < layer.outputs; ++o) {
+                float biasGradient = 0.0f;
+                for (size_t s = 0; s < count; ++s) {
+                    float d = delta[s * deltaStride + o];
+                    if (d == 0.0f)
+                        continue;
+                    biasGradient += d;
+                    DenseKernels::axpy(d, previous + s * layer.stride, weightGradients + o * layer.stride, layer.stride);
+                    if (propagate)
+                        DenseKernels::axpy(d, layer.weights + o * layer.stride, previousDelta + s * layer.stride, layer.stride);
+                }
+                biasGradients[o] += biasGradient;
+            }
+            if (propagate) {
+                for (size_t s = 0; s < count; ++s)
+                    DenseKernels::activationGradient(previous + s * layer.stride, previousDelta + s * layer.stride,
+                                                     layer.inputs, layers_[l - 1].activation);
+                std::swap(delta, previousDelta);
+                deltaStride = layer.stride;
+            }
+        }
+        return total;
+    }
+
+    /**
+     * @brief Writes the network as little-endian binary: "NXNN", version,
+     * layer count, input size, then per layer its output size, activation,
+     * outputs x inputs weights and outputs biases as 32-bit floats.
+     */
+    void save(const std::string& path) const {
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        if (!out)
+            throw std::runtime_error("Cannot write network file " + path);
+        writeU32(out, FILE_MAGIC);
+        writeU32(out, FILE_VERSION);
+        writeU32(out, static_cast<uint32_t>(layers_.size()));
+        writeU32(out, static_cast<uint32_t>(inputSize()));
+        for (const Layer& layer : layers_) {
+            writeU32(out, static_cast<uint32_t>(layer.outputs));
+            writeU32(out, static_cast<uint32_t>(layer.activation));
+            for (size_t o = 0; o < layer.outputs; ++o)
+                out.write(reinterpret_cast<const char*>(layer.weights + o * layer.stride),
+                          static_cast<std::streamsize>(layer.inputs * sizeof(float)));
+            out.write(reinterpret_cast<const char*>(layer.bias),
+                      static_cast<std::streamsize>(layer.outputs * sizeof(float)));
+        }
+        if (!out)
+            throw std::runtime_error("Failed writing network file " + path);
+    }
+
+    static FeedForwardNetwork load(const std::string& path) {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw std::runtime_error("Cannot open network file " + path);
+        if (readU32(in) != FILE_MAGIC || readU32(in) != FILE_VERSION)
+            throw std::runtime_error("Not a network file: " + path);
+        uint32_t layerCount = readU32(in);
+        size_t inputs = readU32(in);
+        FeedForwardNetwork network;
+        for (uint32_t l = 0; l < layerCount; ++l) {
+            size_t outputs = readU32(in);
+            uint32_t activation = readU32(in);
+            if (activation > static_cast<uint32_t>(Activation::Tanh))
+                throw std::runtime_error("Unknown activation in network file " + path);
+            network.addLayer(inputs, outputs, static_cast<Activation>(activation));
+            Layer& layer = network.layers_.back();
+            for (size_t o = 0; o < outputs; ++o)
+                in.read(reinterpret_cast<char*>(layer.weights + o * layer.stride),
+                        static_cast<std::streamsize>(inputs * sizeof(float)));
+            in.read(reinterpret_cast<char*>(layer.bias), static_cast<std::streamsize>(outputs * sizeof(float)));
+            if (!in)
+                throw std::runtime_error("Truncated network file " + path);
+            inputs = outputs;
+        }
+        return network;
+    }
+
+private:
+    static constexpr uint32_t FILE_MAGIC = 0x4E4E584E;   // "NXNN"
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    AlignedBuffer<float> parameters_;
+    std::vector<Layer> layers_;
+
+    // Points each layer into parameters_ after it moved or was copied.
+    void bindLayers() {
+        for (Layer& layer : layers_) {
+            layer.weights = parameters_.data() + layer.offset;
+            layer.bias = layer.weights + layer.outputs * layer.stride;
+        }
+    }
+
+    // Writes d(loss)/d(pre-activation) of the last layer into delta and
+    // returns the summed loss.
+    double lossGradient(const float* outputs, size_t stride, const float* targets, size_t count,
+                        Loss loss, float* delta) const {
+        const Layer& last = layers_.back();
+        double total = 0.0;
+        for (size_t s = 0; s < count; ++s) {
+            const float* y = outputs + s * stride;
+            float* d = delta + s * stride;
+            std::fill(d + last.outputs, d + stride, 0.0f);
+            if (loss == Loss::MeanSquaredError) {
+                for (size_t o = 0; o < last.outputs; ++o) {
+                    float diff = y[o] - targets[s * last.outputs + o];
+                    total += static_cast<double>(diff) * diff;
+                    d[o] = 2.0f * diff;
+                }
+            } else {
+                size_t label = static_cast<size_t>(targets[s]);
+                if (targets[s] < 0.0f || label >= last.outputs)
+                    throw std::invalid_argument("Class index " + std::to_string(targets[s]) + " out of range");
+                float largest = *std::max_element(y, y + last.outputs);
+                float sum = 0.0f;
+                for (size_t o = 0; o < last.outputs; ++o) {
+                    d[o] = std::exp(y[o] - largest);
+                    sum += d[o];
+                }
+                for (size_t o = 0; o < last.outputs; ++o)
+                    d[o] /= sum;
+                total -= std::log(std::max(d[label], std::numeric_limits<float>::min()));
+                d[label] -= 1.0f;
+            }
+            DenseKernels::activationGradient(y, d, last.outputs, last.activation);
+        }
+        return total;
+    }
+
+    static void writeU32(std::ostream& out, uint32_t value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    static uint32_t readU32(std::istream& in) {
+        uint32_t value = 0;
+        if (!in.read(reinterpret_cast<char*>(&value), sizeof(value)))
+            throw std::runtime_error("Truncated network file");
+        return value;
+    }
+};
+
+#endif // NEURALNETWORK_H
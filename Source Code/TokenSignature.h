@@ -0,0 +1,138 @@
+#ifndef TOKENSIGNATURE_H
+#define TOKENSIGNATURE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define TOKENSIGNATURE_X86_DISPATCH 1
+#endif
+
+// ===========================
+// Token Bit Signature
+// ===========================
+
+/**
+ * @brief Fixed-width bit signature of a token-id set.
+ *
+ * Every token id sets one of 256 bits. Two signatures give a cheap upper bound
+ * on the Jaccard similarity of the token sets they summarize, which lets the
+ * knowledge base reject most fuzzy-match candidates before exact scoring.
+ */
+struct alignas(32) TokenSignature {
+    static constexpr size_t BITS = 256;
+    static constexpr size_t WORDS = BITS / 64;
+
+    uint64_t words[WORDS] = {};
+    uint32_t setBits = 0;   ///< Number of bits set in words.
+
+    void add(uint32_t tokenId) {
+        uint32_t bit = (tokenId * 0x9E3779B1u) >> 24;   // Fibonacci hash to [0, 256)
+        uint64_t mask = uint64_t(1) << (bit & 63);
+        if (!(words[bit >> 6] & mask)) {
+            words[bit >> 6] |= mask;
+            ++setBits;
+        }
+    }
+};
+
+// ===========================
+// Popcount Kernels
+// ===========================
+
+namespace SignatureKernels {
+
+using PopcountAndFn = uint32_t (*)(const TokenSignature &, const TokenSignature &);
+
+/**
+ * @brief Portable SWAR popcount of (a & b).
+ */
+inline uint32_t popcountAndScalar(const TokenSignature &a, const TokenSignature &b) {
+    uint32_t total = 0;
+    for (size_t i = 0; i < TokenSignature::WORDS; ++i) {
+        uint64_t x = a.words[i] & b.words[i];
+        x = x - ((x >> 1) & 0x5555555555555555ULL);
+        x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+        x = (x + (x >> 4)) & 0x0F0F0F0F0F0F0F0FULL;
+        total += static_cast<uint32_t>((x * 0x0101010101010101ULL) >> 56);
+    }
+    return total;
+}
+
+#ifdef TOKENSIGNATURE_X86_DISPATCH
+/**
+ * @brief popcount of (a & b) using the SSE4.2-era POPCNT instruction.
+ */
+__attribute__((target("popcnt")))
+inline uint32_t popcountAndPopcnt(const TokenSignature &a, const TokenSignature &b) {
+    uint32_t total = 0;
+    for (size_t i = 0; i < TokenSignature::WORDS; ++i)
+        total += static_cast<uint32_t>(__builtin_popcountll(a.words[i] & b.words[i]));
+    return total;
+}
+
+/**
+ * @brief popcount of (a & b) over one 256-bit AVX2 register (nibble lookup + SAD).
+ */
+__attribute__((target("avx2")))
+inline uint32_t popcountAndAvx2(const TokenSignature &a, const TokenSignature &b) {
+    const __m256i lookup = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                            0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i lowNibble = _mm256_set1_epi8(0x0f);
+    __m256i v = _mm256_and_si256(_mm256_load_si256(reinterpret_cast<const __m256i *>(a.words)),
+                                 _mm256_load_si256(reinterpret_cast<const __m256i *>(b.words)));
+    __m256i lo = _mm256_and_si256(v, lowNibble);
+    __m256i hi = _mm256_and_si256(_mm256_srli_epi16(v, 4), lowNibble);
+    __m256i counts = _mm256_add_epi8(_mm256_shuffle_epi8(lookup, lo), _mm256_shuffle_epi8(lookup, hi));
+    __m256i sums = _mm256_sad_epu8(counts, _mm256_setzero_si256());
+    return static_cast<uint32_t>(_mm256_extract_epi64(sums, 0) + _mm256_extract_epi64(sums, 1) +
+                                 _mm256_extract_epi64(sums, 2) + _mm256_extract_epi64(sums, 3));
+}
+#endif
+
+/**
+ * @brief Picks the fastest kernel the running CPU supports.
+ */
+inline PopcountAndFn selectPopcountAnd() {
+#ifdef TOKENSIGNATURE_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return popcountAndAvx2;
+    if (__builtin_cpu_supports("popcnt"))
+        return popcountAndPopcnt;
+#endif
+    return popcountAndScalar;
+}
+
+inline uint32_t popcountAnd(const TokenSignature &a, const TokenSignature &b) {
+    static const PopcountAndFn kernel = selectPopcountAnd();
+    return kernel(a, b);
+}
+
+/**
+ * @brief Upper bound on the multiset Jaccard similarity of two token sets.
+ *
+ * A bit set in one signature but not the other stands for at least one token
+ * the other set lacks, which caps the possible intersection.
+ *
+ * @param a Signature of the first set.
+ * @param lengthA Token count (with repeats) of the first set.
+ * @param b Signature of the second set.
+ * @param lengthB Token count (with repeats) of the second set.
+ * @return A value never below the exact similarity of the two sets.
+ */
+inline double jaccardUpperBound(const TokenSignature &a, size_t lengthA,
+                                const TokenSignature &b, size_t lengthB) {
+    uint32_t shared = popcountAnd(a, b);
+    size_t onlyA = a.setBits - shared;
+    size_t onlyB = b.setBits - shared;
+    size_t maxCommon = std::min(lengthA - onlyA, lengthB - onlyB);
+    size_t minUnion = lengthA + lengthB - maxCommon;
+    return minUnion == 0 ? 0.0 : static_cast<double>(maxCommon) / minUnion;
+}
+
+} // namespace SignatureKernels
+
+#endif // TOKENSIGNATURE_H
@@ -0,0 +1,7 @@
+# Headless batch query / latency tool; no Qt modules needed.
+TEMPLATE = app
+TARGET = batchquery
+CONFIG += console c++17 thread
+CONFIG -= qt app_bundle
+HEADERS += KnowledgeBase.h TokenSignature.h MinHashIndex.h ConversationLog.h
+SOURCES += BatchQuery.cpp
@@ -0,0 +1,8 @@
+# Google Benchmark suite (needs libbenchmark); no Qt modules needed.
+TEMPLATE = app
+TARGET = kbbenchmark
+CONFIG += console c++17 thread
+CONFIG -= qt app_bundle
+HEADERS += KnowledgeBase.h TokenSignature.h MinHashIndex.h
+SOURCES += KnowledgeBaseBenchmark.cpp
+LIBS += -lbenchmark
@@ -1,6 +1,6 @@
 QT += widgets network core gui widgets network multimedia webenginewidgets
 CONFIG += c++17
-HEADERS += BrowserWindow.h
+HEADERS += BrowserWindow.h KnowledgeBase.h TokenSignature.h MinHashIndex.h MpscRing.h AsyncLogWriter.h ConversationLog.h NeuralNetwork.h
 SOURCES += main.cpp BrowserWindow.cpp ConcreteAIModel.cpp
 
 
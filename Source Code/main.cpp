@@ -31,6 +31,11 @@
 #include <QRegularExpression>
 #include <QMediaPlayer>
 #include <QMediaPlaylist>
+#include <QProgressDialog>
+
+#include "KnowledgeBase.h"
+#include "AsyncLogWriter.h"
+#include "ConversationLog.h"
 
 // Standard headers
 #include <unordered_map>
@@ -43,6 +48,8 @@
 #include <vector>
 #include <random>
 #include <functional>
+#include <cstdint>
+#include <cmath>
 
 // Constants for application
 namespace AppConstants {
@@ -78,284 +85,38 @@ namespace AppConstants {
         "QMenu::item:selected { background-color: #e0e0e0; }";
 }
 
-// -----------------------------
-// Cryptography Helpers
-// -----------------------------
-class Cryptography {
-public:
-    static std::string encrypt(const std::string &data, const std::string &key) {
-        if (data.empty() || key.empty()) return "";
-        std::string iv = generateRandomIV(16);
-        std::string result = iv;
-        for (size_t i = 0; i < data.size(); ++i) {
-            char c = data[i] ^ key[i % key.size()] ^ iv[i % iv.size()];
-            result.push_back(c);
-        }
-        return result;
-    }
-    
-    static std::string decrypt(const std::string &data, const std::string &key) {
-        if (data.empty() || key.empty() || data.size() <= 16) return "";
-        std::string iv = data.substr(0, 16);
-        std::string result;
-        for (size_t i = 16; i < data.size(); ++i) {
-            char c = data[i] ^ key[(i - 16) % key.size()] ^ iv[(i - 16) % iv.size()];
-            result.push_back(c);
-        }
-        return result;
-    }
-    
-private:
-    static std::string generateRandomIV(size_t length) {
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        static std::uniform_int_distribution<> dis(0, 255);
-        std::string iv;
-        iv.reserve(length);
-        for (size_t i = 0; i < length; ++i) {
-            iv.push_back(static_cast<char>(dis(gen)));
-        }
-        return iv;
-    }
-};
-
-// -----------------------------
-// Text Processing Helpers
-// -----------------------------
-class TextProcessor {
-public:
-    static std::string normalizeString(const std::string &input) {
-        std::string normalized;
-        normalized.reserve(input.size());
-        for (char c : input) {
-            if (!std::ispunct(static_cast<unsigned char>(c))) {
-                normalized.push_back(std::tolower(static_cast<unsigned char>(c)));
-            }
-        }
-        return normalized;
-    }
-    
-    static double calculateSimilarity(const std::string &s1, const std::string &s2) {
-        std::vector<std::string> tokens1 = tokenize(s1);
-        std::vector<std::string> tokens2 = tokenize(s2);
-        std::sort(tokens1.begin(), tokens1.end());
-        std::sort(tokens2.begin(), tokens2.end());
-        std::vector<std::string> intersection;
-        std::set_intersection(tokens1.begin(), tokens1.end(),
-                              tokens2.begin(), tokens2.end(),
-                              std::back_inserter(intersection));
-        std::vector<std::string> unionSet;
-        std::set_union(tokens1.begin(), tokens1.end(),
-                       tokens2.begin(), tokens2.end(),
-                       std::back_inserter(unionSet));
-        return unionSet.empty() ? 0.0 : static_cast<double>(intersection.size()) / unionSet.size();
-    }
-
-private:
-    static std::vector<std::string> tokenize(const std::string &str) {
-        std::vector<std::string> tokens;
-        std::istringstream iss(str);
-        std::string token;
-        while (iss >> token)
-            tokens.push_back(normalizeString(token));
-        return tokens;
-    }
-};
-
-// -----------------------------
-// Knowledge Base Manager
-// -----------------------------
-class KnowledgeBase {
-public:
-    KnowledgeBase(const std::string &filename, const std::string &key)
-        : m_filename(filename), m_encryptionKey(key) {
-        loadFromFile();
-    }
-    
-    ~KnowledgeBase() {
-        saveToFile();
-    }
-    
-    void loadFromFile() {
-        std::ifstream inFile(m_filename, std::ios::binary);
-        if (!inFile)
-            return;
-        std::stringstream buffer;
-        buffer << inFile.rdbuf();
-        std::string encryptedData = buffer.str();
-        try {
-            std::string decryptedData = Cryptography::decrypt(encryptedData, m_encryptionKey);
-            parseData(decryptedData);
-        } catch (const std::exception &) {
-            std::string legacyDecrypted = legacyXorDecrypt(encryptedData, m_encryptionKey);
-            parseData(legacyDecrypted);
-        }
-    }
-    
-    void saveToFile() {
-        std::ostringstream oss;
-        for (const auto &pair : m_data)
-            oss << pair.first << "|||" << pair.second << "\n";
-        std::string data = oss.str();
-        std::string encryptedData = Cryptography::encrypt(data, m_encryptionKey);
-        std::ofstream outFile(m_filename, std::ios::binary);
-        if (outFile)
-            outFile << encryptedData;
-    }
-    
-    void addEntry(const std::string &question, const std::string &answer) {
-        std::string normalizedQuestion = TextProcessor::normalizeString(question);
-        m_data[normalizedQuestion] = answer;
-    }
-    
-    std::string findAnswer(const std::string &question) const {
-        std::string normalizedQuestion = TextProcessor::normalizeString(question);
-        auto it = m_data.find(normalizedQuestion);
-        if (it != m_data.end())
-            return it->second;
-        const double SIMILARITY_THRESHOLD = 0.8;
-        std::string bestMatch;
-        double bestScore = 0.0;
-        for (const auto &entry : m_data) {
-            double similarity = TextProcessor::calculateSimilarity(normalizedQuestion, entry.first);
-            if (similarity > SIMILARITY_THRESHOLD && similarity > bestScore) {
-                bestScore = similarity;
-                bestMatch = entry.second;
-            }
-        }
-        return bestMatch;
-    }
-    
-    std::vector<std::pair<std::string, std::string>> getAllEntries() const {
-        std::vector<std::pair<std::string, std::string>> entries;
-        entries.reserve(m_data.size());
-        for (const auto &pair : m_data)
-            entries.emplace_back(pair.first, pair.second);
-        return entries;
-    }
-    
-    void clear() {
-        m_data.clear();
-    }
-    
-    size_t size() const {
-        return m_data.size();
-    }
-
-private:
-    std::string m_filename;
-    std::string m_encryptionKey;
-    std::unordered_map<std::string, std::string> m_data;
-    
-    void parseData(const std::string &data) {
-        std::istringstream iss(data);
-        std::string line;
-        while (std::getline(iss, line)) {
-            if (line.empty())
-                continue;
-            size_t pos = line.find("|||");
-            if (pos == std::string::npos)
-                continue;
-            std::string question = line.substr(0, pos);
-            std::string answer = line.substr(pos + 3);
-            m_data[question] = answer;
-        }
-    }
-    
-    std::string legacyXorDecrypt(const std::string &data, const std::string &key) {
-        std::string result = data;
-        for (size_t i = 0; i < data.size(); ++i)
-            result[i] = data[i] ^ key[i % key.size()];
-        return result;
-    }
-};
-
-// -----------------------------
-// Chat Response Generator
-// -----------------------------
-class ChatResponseGenerator {
-public:
-    ChatResponseGenerator(std::shared_ptr<KnowledgeBase> kb) : m_knowledgeBase(kb) {}
-    
-    std::string generateResponse(const std::string &question) {
-        std::string normalizedQuestion = TextProcessor::normalizeString(question);
-        if (isGreeting(normalizedQuestion))
-            return getRandomGreeting();
-        if (isFarewell(normalizedQuestion))
-            return getRandomFarewell();
-        std::string answer = m_knowledgeBase->findAnswer(normalizedQuestion);
-        return answer.empty() ? "" : answer;
-    }
-
-private:
-    std::shared_ptr<KnowledgeBase> m_knowledgeBase;
-    
-    bool isGreeting(const std::string &text) {
-        static const std::vector<std::string> greetings = {
-            "hello", "hi", "hey", "greetings", "good morning", "good afternoon", "good evening", "howdy"
-        };
-        for (const auto &greeting : greetings)
-            if (text.find(greeting) != std::string::npos)
-                return true;
-        return false;
-    }
-    
-    bool isFarewell(const std::string &text) {
-        static const std::vector<std::string> farewells = {
-            "bye", "goodbye", "see you", "farewell", "later", "take care"
-        };
-        for (const auto &farewell : farewells)
-            if (text.find(farewell) != std::string::npos)
-                return true;
-        return false;
-    }
-    
-    std::string getRandomGreeting() {
-        static const std::vector<std::string> responses = {
-            "Hello there! How can I help you today?",
-            "Hi! What can I do for you?",
-            "Greetings! How may I assist you?",
-            "Hello! I'm ready to help. What do you need?",
-            "Hey there! What's on your mind today?"
-        };
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(0, responses.size() - 1);
-        return responses[dis(gen)];
-    }
-    
-    std::string getRandomFarewell() {
-        static const std::vector<std::string> responses = {
-            "Goodbye! Have a great day!",
-            "See you later! Feel free to chat again anytime.",
-            "Farewell! It was nice chatting with you.",
-            "Take care! Come back soon.",
-            "Bye for now! I'll be here if you need anything else."
-        };
-        static std::random_device rd;
-        static std::mt19937 gen(rd());
-        std::uniform_int_distribution<> dis(0, responses.size() - 1);
-        return responses[dis(gen)];
-    }
-};
-
 // -----------------------------
 // Log Manager
 // -----------------------------
 class LogManager {
 public:
+    // Formats and queues the line; the file is written on the log writer's thread.
     static void log(const QString &message, bool toConsole = true) {
         QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
         QString logEntry = QString("[%1] %2").arg(timestamp).arg(message);
         if (toConsole)
             qDebug("%s", qPrintable(logEntry));
-        QDir().mkpath("logs");
-        QFile file("logs/chatbot.log");
-        if (file.open(QIODevice::WriteOnly | QIODevice::Append | QIODevice::Text)) {
-            QTextStream stream(&file);
-            stream << logEntry << "\n";
-            file.close();
-        }
+        static const bool logDirectory = QDir().mkpath("logs");
+        Q_UNUSED(logDirectory);
+        static AsyncLogWriter writer("logs/chatbot.log", writerOptions());
+        writer.append((logEntry + "\n").toStdString());
+    }
+
+    // Log settings live in the [log] group of the settings file:
+    // fsync = never | batch | interval, fsyncIntervalMs, maxFileBytes, maxFiles.
+    static AsyncLogWriter::Options writerOptions() {
+        QSettings settings(AppConstants::SETTINGS_FILE, QSettings::IniFormat);
+        AsyncLogWriter::Options options;
+        QString fsync = settings.value("log/fsync", "interval").toString();
+        if (fsync == "never")
+            options.fsync = AsyncLogWriter::FsyncPolicy::Never;
+        else if (fsync == "batch")
+            options.fsync = AsyncLogWriter::FsyncPolicy::EveryBatch;
+        options.fsyncInterval = std::chrono::milliseconds(
+            settings.value("log/fsyncIntervalMs", static_cast<qlonglong>(options.fsyncInterval.count())).toLongLong());
+        options.maxFileBytes = settings.value("log/maxFileBytes", static_cast<qulonglong>(options.maxFileBytes)).toULongLong();
+        options.maxRotatedFiles = settings.value("log/maxFiles", options.maxRotatedFiles).toUInt();
+        return options;
     }
 };
 
@@ -387,7 +148,11 @@ public:
         const std::string knowledgeBaseFile = "knowledge_base.dat";
         const std::string encryptionKey = "k1eFjP@7xL9qZ#5mR2tY8sA3vB6nC0wD";
         m_knowledgeBase = std::make_shared<KnowledgeBase>(knowledgeBaseFile, encryptionKey);
-        m_responseGenerator = std::make_shared<ChatResponseGenerator>(m_knowledgeBase);
+        m_responseGenerator = std::make_shared<ChatResponseGenerator>(
+            m_knowledgeBase, ChatResponseGenerator::DEFAULT_CACHE_CAPACITY, loadIntentRules());
+        m_queryEngine = std::make_unique<QueryEngine>(m_responseGenerator);
+        // Answers arrive on worker threads; hop back to the GUI thread before touching widgets.
+        connect(this, &ChatWindow::responseReady, this, &ChatWindow::onResponseReady, Qt::QueuedConnection);
         player = new QMediaPlayer(this);
         // Initialize network managers only once inside setupUI
         setupUI();
@@ -397,10 +162,15 @@ public:
     }
 
     ~ChatWindow() {
+        m_queryEngine.reset();
         saveSettings();
         LogManager::log("Application closed");
     }
 
+signals:
+    // error is empty unless the lookup failed.
+    void responseReady(quint64 ticket, const QString &question, const QString &response, const QString &error);
+
 private slots:
     void onSendMessage() {
         QString userText = inputField->text().trimmed();
@@ -412,15 +182,32 @@ private slots:
             return;
         }
         displayUserMessage(userText);
-        appendToConversationLog("User: " + userText);
+        appendToConversationLog(ConversationLog::Role::User, userText);
         inputField->clear();
-        std::string response = m_responseGenerator->generateResponse(userText.toStdString());
-        if (response.empty())
-            askForAnswer(userText.toStdString());
+        m_queryEngine->cancelPending();
+        m_pendingQuery = m_queryEngine->submit(userText.toStdString(),
+            [this, userText](uint64_t ticket, const std::string &response) {
+                emit responseReady(ticket, userText, QString::fromStdString(response), QString());
+            },
+            [this, userText](uint64_t ticket, const std::string &error) {
+                emit responseReady(ticket, userText, QString(), QString::fromStdString(error));
+            });
+        statusBar()->showMessage("Thinking...");
+    }
+
+    void onResponseReady(quint64 ticket, const QString &question, const QString &response, const QString &error) {
+        if (ticket != m_pendingQuery)
+            return;   // The user has asked something newer since
+        statusBar()->clearMessage();
+        if (!error.isEmpty()) {
+            LogManager::log("Lookup failed for \"" + question + "\": " + error);
+            displayBotMessage("Sorry, something went wrong while looking that up. Please try again.");
+            statusBar()->showMessage("Could not look up an answer", 3000);
+        } else if (response.isEmpty())
+            askForAnswer(question.toStdString());
         else {
-            QString botMessage = QString::fromStdString(response);
-            displayBotMessage(botMessage);
-            appendToConversationLog("Bot: " + botMessage);
+            displayBotMessage(response);
+            appendToConversationLog(ConversationLog::Role::Bot, response);
         }
     }
     
@@ -470,14 +257,25 @@ private slots:
         reply->deleteLater();
     }
     
-    // Standard web data loader remains unchanged
+    // Standard web data loader; the download is decrypted as it streams in
     void onLoadDataFromWeb() {
         m_isTrainingRequest = false;
         statusBar()->showMessage("Loading data from website...");
         conversationDisplay->append(formatInfoMessage("Loading data from website..."));
         QUrl url("https://raw.githubusercontent.com/NexiaMindAI/NexiaMindAI-CPP/refs/heads/main/Assets/knowledge_base.dat");
         QNetworkRequest request(url);
-        m_networkManager->get(request);
+        QNetworkReply *reply = m_networkManager->get(request);
+        m_webImport.reset(new WebImport{reply, Cryptography::Decryptor("k1eFjP@7xL9qZ#5mR2tY8sA3vB6nC0wD"), LineSplitter(), 0, 0, IngestBatch()});
+        connect(reply, &QNetworkReply::readyRead, this, &ChatWindow::onWebDataReady);
+    }
+    
+    // Streams the knowledge-base download: each chunk is decrypted in place and
+    // split into lines as it arrives, so the file is never held in memory whole.
+    void onWebDataReady() {
+        QNetworkReply *reply = qobject_cast<QNetworkReply*>(sender());
+        if (!reply || !m_webImport || reply != m_webImport->reply)
+            return;
+        consumeWebData(reply->readAll());
     }
     
     // Train button: Train from DuckDuckGo
@@ -501,14 +299,24 @@ private slots:
     
     // Unified network reply slot handling both loading and training
     void onNetworkReply(QNetworkReply *reply) {
+        bool isWebImport = m_webImport && reply == m_webImport->reply;
         if (reply->error() != QNetworkReply::NoError) {
             conversationDisplay->append(formatInfoMessage("Error loading data: " + reply->errorString()));
             statusBar()->showMessage("Error loading data", 3000);
             m_isTrainingRequest = false;
+            if (isWebImport) {
+                m_knowledgeBase->addEntries(m_webImport->batch.entries());   // Keep what arrived intact
+                m_webImport.reset();
+            }
             reply->deleteLater();
             return;
         }
         
+        if (isWebImport) {
+            finishWebImport(reply);
+            return;
+        }
+        
         QByteArray data = reply->readAll();
         if (m_isTrainingRequest) {
             QJsonDocument jsonDoc = QJsonDocument::fromJson(data);
@@ -538,7 +346,7 @@ private slots:
                     }
                 }
             }
-            m_knowledgeBase->saveToFile();
+            saveKnowledgeBase();
             conversationDisplay->append(formatInfoMessage("Training complete: loaded " + QString::number(count) + " entries from DuckDuckGo."));
             statusBar()->showMessage("Training complete", 3000);
             m_isTrainingRequest = false;
@@ -546,39 +354,8 @@ private slots:
             return;
         }
         
-        // Process standard knowledge base data
-        QByteArray downloadedData = data;
-        if (downloadedData.isEmpty()) {
-            conversationDisplay->append(formatInfoMessage("No data received from server"));
-            statusBar()->showMessage("No data received", 3000);
-            reply->deleteLater();
-            return;
-        }
-        try {
-            std::string encryptedData(downloadedData.constData(), downloadedData.size());
-            std::string decryptedData = Cryptography::decrypt(encryptedData, "k1eFjP@7xL9qZ#5mR2tY8sA3vB6nC0wD");
-            std::istringstream iss(decryptedData);
-            std::string line;
-            int count = 0;
-            while (std::getline(iss, line)) {
-                if (line.empty())
-                    continue;
-                size_t pos = line.find("|||");
-                if (pos == std::string::npos)
-                    continue;
-                std::string question = line.substr(0, pos);
-                std::string answer = line.substr(pos + 3);
-                question = TextProcessor::normalizeString(question);
-                m_knowledgeBase->addEntry(question, answer);
-                ++count;
-            }
-            m_knowledgeBase->saveToFile();
-            conversationDisplay->append(formatInfoMessage("Loaded " + QString::number(count) + " new entries from the website and updated the knowledge base."));
-            statusBar()->showMessage("Data loaded successfully", 3000);
-        } catch (const std::exception &e) {
-            conversationDisplay->append(formatInfoMessage("Error processing data: " + QString(e.what())));
-            statusBar()->showMessage("Error processing data", 3000);
-        }
+        // Knowledge-base downloads are streamed through onWebDataReady; anything
+        // else reaching this point (e.g. TTS audio) is handled by its own slot.
         reply->deleteLater();
     }
     
@@ -591,9 +368,7 @@ private slots:
             QMessageBox::warning(this, "Error", "Unable to open the selected file.");
             return;
         }
-        QByteArray fileData = file.readAll();
-        file.close();
-        int count = processJSONData(fileData);
+        int count = importJSONFile(file);
         if (count > 0)
             conversationDisplay->append(formatInfoMessage("Automatically loaded " + QString::number(count) + " entries from JSON."));
     }
@@ -604,29 +379,39 @@ private slots:
         SettingsManager::saveSettings("darkTheme", m_isDarkTheme);
     }
     
+    // Entries are serialized straight from the knowledge base into the file.
     void onExportKnowledgeBase() {
-        QString fileName = QFileDialog::getSaveFileName(this, "Export Knowledge Base", "", "JSON Files (*.json)");
+        const QString compactFilter = "Compact JSON (*.json)";
+        const QString linesFilter = "JSON Lines (*.jsonl)";
+        QString selectedFilter;
+        QString fileName = QFileDialog::getSaveFileName(this, "Export Knowledge Base", "",
+                                                        "JSON Files (*.json);;" + compactFilter + ";;" + linesFilter,
+                                                        &selectedFilter);
         if (fileName.isEmpty())
             return;
-        if (!fileName.endsWith(".json"))
-            fileName += ".json";
-        QJsonArray jsonArray;
-        auto entries = m_knowledgeBase->getAllEntries();
-        for (const auto &entry : entries) {
-            QJsonObject obj;
-            obj["question"] = QString::fromStdString(entry.first);
-            obj["answer"] = QString::fromStdString(entry.second);
-            jsonArray.append(obj);
-        }
-        QJsonDocument jsonDoc(jsonArray);
+        JsonEntryWriter::Layout layout = selectedFilter == compactFilter ? JsonEntryWriter::Layout::Compact
+                                       : selectedFilter == linesFilter ? JsonEntryWriter::Layout::Lines
+                                       : JsonEntryWriter::Layout::Indented;
+        QString extension = layout == JsonEntryWriter::Layout::Lines ? ".jsonl" : ".json";
+        if (!fileName.endsWith(extension))
+            fileName += extension;
         QFile file(fileName);
-        if (file.open(QIODevice::WriteOnly)) {
-            file.write(jsonDoc.toJson(QJsonDocument::Indented));
-            file.close();
-            statusBar()->showMessage("Knowledge base exported successfully", 3000);
-        } else {
+        if (!file.open(QIODevice::WriteOnly)) {
             QMessageBox::warning(this, "Error", "Unable to write to the selected file.");
+            return;
         }
+        JsonEntryWriter writer(layout, [&file](const char *data, size_t length) {
+            file.write(data, static_cast<qint64>(length));
+        });
+        m_knowledgeBase->forEachEntry([&writer](std::string_view question, std::string_view answer) {
+            writer.write(question, answer);
+        });
+        writer.finish();
+        file.close();
+        if (file.error() != QFileDevice::NoError)
+            QMessageBox::warning(this, "Error", "Unable to write to the selected file.");
+        else
+            statusBar()->showMessage(QString("Exported %1 entries").arg(writer.count()), 3000);
     }
     
     void onClearConversation() {
@@ -645,7 +430,7 @@ private slots:
             "<li>Web-based knowledge updates and training (from DuckDuckGo)</li>"
             "<li>Dark/light theme support</li>"
             "<li>Markdown rendering support</li>"
-            "<li>Command parsing (/help, /clear, /export, /log on/off, /remind, /trainfile)</li>"
+            "<li>Command parsing (/help, /clear, /export, /log on/off, /remind, /trainfile, /stats)</li>"
             "<li>Google Voice (unofficial Google Translate TTS) output</li>"
             "<li>Conversation logging to a file</li>"
             "</ul>"
@@ -663,10 +448,26 @@ private:
     QNetworkAccessManager *m_networkManager;
     std::shared_ptr<KnowledgeBase> m_knowledgeBase;
     std::shared_ptr<ChatResponseGenerator> m_responseGenerator;
+    std::unique_ptr<QueryEngine> m_queryEngine;
+    quint64 m_pendingQuery = 0;   // Ticket of the question awaiting an answer
     QMediaPlayer *player;
     bool m_isDarkTheme = true;
     bool m_isTrainingRequest;
+    
+    struct WebImport {
+        QNetworkReply *reply;
+        Cryptography::Decryptor decryptor;
+        LineSplitter lines;
+        qint64 bytesReceived;
+        int count;
+        IngestBatch batch;
+    };
+    static constexpr size_t IMPORT_BATCH_SIZE = 4096;   // Entries per KnowledgeBase::addEntries call
+    std::unique_ptr<WebImport> m_webImport;   // Knowledge-base download in progress
     bool m_loggingEnabled;
+    std::unique_ptr<AsyncLogWriter> m_conversationLog;   // Opened on first use
+    bool m_binaryConversationLog = false;
+    ConversationLogEncoder m_conversationEncoder;
     QString m_lastBotMessage;
     
     void setupUI() {
@@ -753,12 +554,26 @@ private:
         setStyleSheet(m_isDarkTheme ? AppConstants::DEFAULT_STYLE : AppConstants::LIGHT_STYLE);
     }
     
+    // Intent rules come from intents.txt (setting intentRulesFile) when it
+    // exists; otherwise the built-in greeting and farewell rules apply.
+    std::shared_ptr<const IntentMatcher> loadIntentRules() {
+        QString path = SettingsManager::loadSettings("intentRulesFile", "intents.txt").toString();
+        if (!QFile::exists(path))
+            return nullptr;
+        try {
+            auto matcher = std::make_shared<IntentMatcher>(IntentRules::load(path.toStdString()));
+            LogManager::log(QString("Loaded %1 intent phrases from %2").arg(matcher->rules().phrases.size()).arg(path));
+            return matcher;
+        } catch (const std::exception &e) {
+            LogManager::log("Failed to load intent rules: " + QString(e.what()));
+            return nullptr;
+        }
+    }
+    
     void loadSampleData() {
         QFile autoJson("sample.json");
         if (autoJson.exists() && autoJson.open(QIODevice::ReadOnly)) {
-            QByteArray jsonData = autoJson.readAll();
-            autoJson.close();
-            int count = processJSONData(jsonData);
+            int count = importJSONFile(autoJson);
             if (count > 0)
                 conversationDisplay->append(formatInfoMessage("Automatically loaded " + QString::number(count) + " entries from sample.json."));
             else
@@ -768,32 +583,124 @@ private:
         }
     }
     
-    int processJSONData(const QByteArray &jsonData) {
-        QJsonDocument jsonDoc = QJsonDocument::fromJson(jsonData);
-        if (!jsonDoc.isArray()) {
-            QMessageBox::warning(this, "Error", "JSON is not in the expected array format.");
-            return 0;
-        }
-        QJsonArray jsonArray = jsonDoc.array();
+    // Streams a [{"question": .., "answer": ..}, ...] file into the knowledge base
+    // in batches, reading fixed-size blocks behind a progress dialog. Entries
+    // before a syntax error are kept. Returns the number of entries read.
+    int importJSONFile(QFile &file) {
+        QProgressDialog progress("Importing training data...", "Cancel", 0, 1000, this);
+        progress.setWindowModality(Qt::WindowModal);
+        progress.setMinimumDuration(500);
+        const qint64 totalBytes = std::max<qint64>(file.size(), 1);
+        JsonEntryReader reader;
+        IngestBatch batch;
         int count = 0;
-        for (const QJsonValue &value : jsonArray) {
-            if (!value.isObject())
-                continue;
-            QJsonObject obj = value.toObject();
-            if (obj.contains("question") && obj.contains("answer")) {
-                QString question = obj.value("question").toString().trimmed();
-                QString answer = obj.value("answer").toString().trimmed();
-                if (!question.isEmpty() && !answer.isEmpty()) {
-                    std::string normalizedQuestion = TextProcessor::normalizeString(question.toStdString());
-                    m_knowledgeBase->addEntry(normalizedQuestion, answer.toStdString());
-                    ++count;
-                }
+        auto onEntry = [&](std::string_view question, std::string_view answer) {
+            batch.add(question, answer);
+            ++count;
+            if (batch.size() == IMPORT_BATCH_SIZE) {
+                m_knowledgeBase->addEntries(batch.entries());
+                batch.clear();
+            }
+        };
+        std::vector<char> block(Cryptography::BLOCK_SIZE);
+        try {
+            qint64 bytesRead;
+            while ((bytesRead = file.read(block.data(), static_cast<qint64>(block.size()))) > 0) {
+                reader.append(block.data(), static_cast<size_t>(bytesRead), onEntry);
+                progress.setValue(static_cast<int>(reader.bytesRead() * 1000 / totalBytes));
+                if (progress.wasCanceled())
+                    break;
             }
+            if (!progress.wasCanceled())
+                reader.finish();
+        } catch (const std::exception &e) {
+            m_knowledgeBase->addEntries(batch.entries());
+            if (!reader.started()) {
+                QMessageBox::warning(this, "Error", "JSON is not in the expected array format.");
+                return 0;
+            }
+            QMessageBox::warning(this, "Error", QString("Import stopped after %1 entries. %2").arg(count).arg(e.what()));
+            return count;
         }
+        m_knowledgeBase->addEntries(batch.entries());
+        progress.setValue(1000);
         statusBar()->showMessage(QString("Loaded %1 entries from JSON").arg(count), 3000);
         return count;
     }
     
+    // Streams "question|||answer" lines from `file` into the knowledge base in batches.
+    int importTextFile(QFile &file) {
+        LineSplitter lines;
+        IngestBatch batch;
+        int count = 0;
+        auto onLine = [&](std::string_view line) {
+            size_t pos = line.find("|||");
+            if (pos == std::string_view::npos || line.find("|||", pos + 3) != std::string_view::npos)
+                return;
+            batch.add(line.substr(0, pos), line.substr(pos + 3));
+            ++count;
+            if (batch.size() == IMPORT_BATCH_SIZE) {
+                m_knowledgeBase->addEntries(batch.entries());
+                batch.clear();
+            }
+        };
+        std::vector<char> block(Cryptography::BLOCK_SIZE);
+        qint64 bytesRead;
+        while ((bytesRead = file.read(block.data(), static_cast<qint64>(block.size()))) > 0)
+            lines.append(block.data(), static_cast<size_t>(bytesRead), onLine);
+        lines.finish(onLine);
+        m_knowledgeBase->addEntries(batch.entries());
+        return count;
+    }
+    
+    void consumeWebData(QByteArray chunk) {
+        m_webImport->bytesReceived += chunk.size();
+        m_webImport->decryptor.update(chunk.data(), static_cast<size_t>(chunk.size()), [this](const char *data, size_t length) {
+            m_webImport->lines.append(data, length, [this](std::string_view line) { importWebLine(line); });
+        });
+    }
+    
+    void importWebLine(std::string_view line) {
+        size_t pos = line.find("|||");
+        if (pos == std::string_view::npos)
+            return;
+        m_webImport->batch.add(line.substr(0, pos), line.substr(pos + 3));
+        ++m_webImport->count;
+        if (m_webImport->batch.size() == IMPORT_BATCH_SIZE) {
+            m_knowledgeBase->addEntries(m_webImport->batch.entries());
+            m_webImport->batch.clear();
+        }
+    }
+    
+    void finishWebImport(QNetworkReply *reply) {
+        try {
+            consumeWebData(reply->readAll());
+            if (m_webImport->bytesReceived == 0) {
+                conversationDisplay->append(formatInfoMessage("No data received from server"));
+                statusBar()->showMessage("No data received", 3000);
+            } else {
+                m_webImport->lines.finish([this](std::string_view line) { importWebLine(line); });
+                m_knowledgeBase->addEntries(m_webImport->batch.entries());
+                saveKnowledgeBase();
+                conversationDisplay->append(formatInfoMessage("Loaded " + QString::number(m_webImport->count) + " new entries from the website and updated the knowledge base."));
+                statusBar()->showMessage("Data loaded successfully", 3000);
+            }
+        } catch (const std::exception &e) {
+            conversationDisplay->append(formatInfoMessage("Error processing data: " + QString(e.what())));
+            statusBar()->showMessage("Error processing data", 3000);
+        }
+        m_webImport.reset();
+        reply->deleteLater();
+    }
+    
+    // Saves the knowledge base and warns when some changes could not be written.
+    void saveKnowledgeBase() {
+        if (m_knowledgeBase->saveToFile())
+            return;
+        LogManager::log("Failed to save the knowledge base; recent changes exist only in memory");
+        conversationDisplay->append(formatInfoMessage("Warning: the knowledge base could not be saved. Recent changes will be lost if the application closes."));
+    }
+    
     void askForAnswer(const std::string &question) {
         QMessageBox::StandardButton replyButton = QMessageBox::question(this, "Teach ChatBot",
             "I don't know the answer to that question.\nWould you like to teach me?",
@@ -806,8 +713,9 @@ private:
                 m_knowledgeBase->addEntry(normalizedQuestion, answer.toStdString());
                 conversationDisplay->append(formatInfoMessage("Thank you for teaching me!"));
                 displayBotMessage(answer);
+                saveKnowledgeBase();
                 LogManager::log("New knowledge added: Q: " + QString::fromStdString(question));
-                appendToConversationLog("Bot: " + answer);
+                appendToConversationLog(ConversationLog::Role::Bot, answer);
             } else {
                 displayBotMessage("Alright, let's move on.");
             }
@@ -816,7 +724,7 @@ private:
         }
     }
     
-    // Command processor: supports /help, /clear, /export, /log on/off, /remind, /trainfile
+    // Command processor: supports /help, /clear, /export, /log on/off, /remind, /trainfile, /stats
     void processCommand(const QString &command) {
         if (command.compare("/help", Qt::CaseInsensitive) == 0) {
             QString helpText =
@@ -826,12 +734,18 @@ private:
                 "/export - Export conversation history\n"
                 "/log on|off - Turn conversation logging on or off\n"
                 "/remind <seconds> <message> - Set a reminder\n"
-                "/trainfile - Load training data from a file";
+                "/trainfile - Load training data from a file\n"
+                "/stats - Show knowledge base and answer cache statistics";
             displayBotMessage(helpText);
         } else if (command.compare("/clear", Qt::CaseInsensitive) == 0) {
             onClearConversation();
         } else if (command.compare("/export", Qt::CaseInsensitive) == 0) {
             onExportKnowledgeBase();
+        } else if (command.compare("/stats", Qt::CaseInsensitive) == 0) {
+            AnswerCache::Stats cache = m_responseGenerator->cacheStats();
+            displayBotMessage(QString("Knowledge base: %1 entries\nAnswer cache: %2/%3 entries, %4 hits, %5 misses (%6% hit ratio)")
+                .arg(m_knowledgeBase->size()).arg(cache.entries).arg(cache.capacity)
+                .arg(cache.hits).arg(cache.misses).arg(100.0 * cache.hitRatio(), 0, 'f', 1));
         } else if (command.startsWith("/log ", Qt::CaseInsensitive)) {
             QString param = command.mid(5).trimmed().toLower();
             if (param == "on") {
@@ -858,7 +772,7 @@ private:
                         QString reminder = "Reminder: " + reminderMessage;
                         displayBotMessage(reminder);
                         speakWithGoogleVoice(reminder);
-                        appendToConversationLog("Bot (reminder): " + reminder);
+                        appendToConversationLog(ConversationLog::Role::Reminder, reminder);
                     });
                     displayBotMessage("Reminder set for " + QString::number(seconds) + " seconds.");
                 }
@@ -868,28 +782,15 @@ private:
             if (!fileName.isEmpty()) {
                 QFile file(fileName);
                 if (file.open(QIODevice::ReadOnly)) {
-                    QByteArray fileData = file.readAll();
-                    file.close();
-                    int count = processJSONData(fileData);
-                    if (count == 0) {
-                        QString content = QString(fileData);
-                        QStringList lines = content.split("\n", Qt::SkipEmptyParts);
-                        int localCount = 0;
-                        for (const QString &line : lines) {
-                            if (line.contains("|||")) {
-                                QStringList parts = line.split("|||");
-                                if (parts.size() == 2) {
-                                    m_knowledgeBase->addEntry(parts[0].toStdString(), parts[1].toStdString());
-                                    ++localCount;
-                                }
-                            }
-                        }
-                        m_knowledgeBase->saveToFile();
+                    int count = importJSONFile(file);
+                    if (count == 0 && file.seek(0)) {
+                        int localCount = importTextFile(file);
+                        saveKnowledgeBase();
                         displayBotMessage("Loaded " + QString::number(localCount) + " entries from text file.");
                     } else {
                         displayBotMessage("Loaded " + QString::number(count) + " entries from JSON file.");
                     }
-                    appendToConversationLog("Command /trainfile executed.");
+                    appendToConversationLog(ConversationLog::Role::System, "Command /trainfile executed.");
                 } else {
                     displayBotMessage("Failed to open the file.");
                 }
@@ -899,17 +800,28 @@ private:
         }
     }
     
-    // Append message to conversation log if logging enabled
-    void appendToConversationLog(const QString &message) {
+    // Append message to conversation log if logging enabled. The format is
+    // chosen by log/conversationFormat: "text" (conversation_log.txt) or
+    // "binary" (conversation_log.bin, see ConversationLog.h).
+    void appendToConversationLog(ConversationLog::Role role, const QString &message) {
         if (!m_loggingEnabled)
             return;
-        QFile file("conversation_log.txt");
-        if (file.open(QIODevice::Append | QIODevice::Text)) {
-            QTextStream out(&file);
-            QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
-            out << "[" << timestamp << "] " << message << "\n";
-            file.close();
+        if (!m_conversationLog) {
+            AsyncLogWriter::Options options = LogManager::writerOptions();
+            m_binaryConversationLog = SettingsManager::loadSettings("log/conversationFormat", "text").toString() == "binary";
+            if (m_binaryConversationLog)
+                options.fileHeader = ConversationLog::fileHeader;
+            m_conversationLog = std::make_unique<AsyncLogWriter>(
+                m_binaryConversationLog ? "conversation_log.bin" : "conversation_log.txt", options);
+        }
+        if (m_binaryConversationLog) {
+            m_conversationLog->append(m_conversationEncoder.encode(ConversationLog::nowMs(), role, message.toStdString()));
+            return;
         }
+        QString timestamp = QDateTime::currentDateTime().toString("yyyy-MM-dd hh:mm:ss");
+        QString line = role == ConversationLog::Role::System
+            ? message : QString("%1: %2").arg(ConversationLog::roleName(role), message);
+        m_conversationLog->append(QString("[%1] %2\n").arg(timestamp, line).toStdString());
     }
     
     // Display functions with markdown support